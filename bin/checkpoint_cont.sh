@@ -0,0 +1,74 @@
+#! /bin/bash
+
+# Checkpoints container process tree with CRIU into memory backed (tmpfs)
+# snapshots dir: PRE_DUMPS incremental pre-dumps (memory only, container keeps
+# running, every one writes only pages changed since previous) go to pre1,
+# pre2, ..., then final dump goes to images
+# usage: checkpoint_cont.sh CONT_PID SNAPSHOTS_DIR SNAPSHOT_NAME PRE_DUMPS "EXTERNAL..." LEAVE_RUNNING
+#   EXTERNAL      - CRIU key of host file, which container init holds (`file[..]`, `tty[..]`);
+#                   list isn't the last argument, so caller quotes it
+#   LEAVE_RUNNING - 1 if container keeps running after dump, 0 if CRIU kills it
+
+if [ "$#" -ne 6 ]; then
+    exit 1 # wrong number of arguments
+fi
+
+CONT_PID=$1
+SNAPSHOTS_DIR=$2
+SNAPSHOT_DIR=${SNAPSHOTS_DIR}/$3
+PRE_DUMPS=$4
+EXTERNALS=$5
+LEAVE_RUNNING=$6
+
+# CRIU keys look like glob patterns
+set -f
+
+if ! sudo criu --version > /dev/null 2>&1; then
+    exit 2 # no criu
+fi
+
+# mounting snapshots tmpfs if needed
+if [ -z "$(mount | grep "$SNAPSHOTS_DIR")" ]; then
+    mkdir -p "$SNAPSHOTS_DIR" && \
+    sudo mount -t tmpfs -o mode=0700,uid=$UID,gid=$(id -g) aucont_snapshots "$SNAPSHOTS_DIR"
+    if [ "$?" -ne "0" ]; then
+        exit 3 # error mounting
+    fi
+fi
+
+if ! mkdir "$SNAPSHOT_DIR"; then
+    exit 4 # snapshot exists
+fi
+
+# cgroups of container are named after its pid, restored container gets new ones;
+# bind mounts of host files (/dev/null, ...) are bound again from same host paths
+CRIU_OPTS="-t ${CONT_PID} --tcp-established --file-locks --ext-unix-sk --manage-cgroups=ignore \
+    --ext-mount-map auto --enable-external-sharing --enable-external-masters"
+for EXTERNAL in $EXTERNALS; do
+    CRIU_OPTS="${CRIU_OPTS} --external ${EXTERNAL}"
+done
+
+PREV_OPTS=""
+for I in $(seq 1 "$PRE_DUMPS"); do
+    mkdir "${SNAPSHOT_DIR}/pre${I}" && \
+    sudo criu pre-dump ${CRIU_OPTS} --track-mem ${PREV_OPTS} -D "${SNAPSHOT_DIR}/pre${I}" -o pre-dump.log
+    if [ "$?" -ne "0" ]; then
+        exit 5 # pre-dump failed
+    fi
+    # relative to images dir of next dump
+    PREV_OPTS="--prev-images-dir ../pre${I}"
+done
+
+if [ "$PRE_DUMPS" -gt 0 ]; then
+    PREV_OPTS="${PREV_OPTS} --track-mem"
+fi
+if [ "$LEAVE_RUNNING" -eq 1 ]; then
+    PREV_OPTS="${PREV_OPTS} --leave-running"
+fi
+mkdir "${SNAPSHOT_DIR}/images" && \
+sudo criu dump ${CRIU_OPTS} ${PREV_OPTS} -D "${SNAPSHOT_DIR}/images" -o dump.log
+if [ "$?" -ne "0" ]; then
+    exit 6 # dump failed
+fi
+
+exit 0
@@ -0,0 +1,13 @@
+#! /bin/bash
+
+# Publishes container ports on host with aucont_portmap helper, which keeps
+# DNAT rules (and host ports) until container exits
+# usage: publish_ports.sh CONT_PID HOST_VETH CONT_IP HOST_PORT:CONT_PORT[/udp]...
+
+if [ "$#" -lt 4 ]; then
+    exit 1
+fi
+
+sudo "$(dirname "$0")/aucont_portmap" "$@"
+
+exit $?
@@ -0,0 +1,16 @@
+#! /bin/bash
+
+# Removes cgroups of exited containers, when caller can't do it itself
+# (parent dir is hierarchy root, which belongs to root)
+# usage: remove_cont_cgroups.sh CGROUP_DIR...
+
+if [ "$#" -lt 1 ]; then
+    exit 1 # wrong number of arguments
+fi
+
+# directories, which are gone or still have processes, are skipped
+for CGROUP_DIR in "$@"; do
+    sudo rmdir "$CGROUP_DIR" > /dev/null 2>&1
+done
+
+exit 0
@@ -0,0 +1,44 @@
+#! /bin/bash
+
+if [ "$#" -ne 3 ]; then
+    exit 1 # wrong number of arguments
+fi
+
+# container init pid; restored container has all its processes listed
+CONT_PIDS=$1
+CGROUP2_HIERARCHY_DIR=$2
+CGROUP_NAME=$3
+CONT_CGROUP_DIR=${CGROUP2_HIERARCHY_DIR}/${CGROUP_NAME}
+
+if ! grep -qw cgroup2 /proc/filesystems; then
+    exit 2 # no cgroup v2 in kernel
+fi
+
+# mounting cgroup v2 hierarchy if needed (it's the same hierarchy, wherever it is mounted)
+if [ -z "$(mount | grep "$CGROUP2_HIERARCHY_DIR")" ]; then
+    mkdir -p "$CGROUP2_HIERARCHY_DIR" && \
+    sudo mount -t cgroup2 aucont_cgroup2h "$CGROUP2_HIERARCHY_DIR"
+    if [ "$?" -ne "0" ]; then
+        exit 3 # error mounting
+    fi
+fi
+
+# controllers, which are not bound to v1 hierarchies, are enabled for containers
+for CONTROLLER in cpu memory; do
+    if grep -qw "$CONTROLLER" "${CGROUP2_HIERARCHY_DIR}/cgroup.controllers" && \
+       ! grep -qw "$CONTROLLER" "${CGROUP2_HIERARCHY_DIR}/cgroup.subtree_control"; then
+        echo "+$CONTROLLER" | sudo tee -a "${CGROUP2_HIERARCHY_DIR}/cgroup.subtree_control" > /dev/null 2>&1
+    fi
+done
+
+GID=$(id -g)
+sudo mkdir -p "$CONT_CGROUP_DIR" && \
+sudo chown -R $UID:$GID "$CONT_CGROUP_DIR"
+if [ "$?" -ne "0" ]; then
+    exit 4
+fi
+for PID in $CONT_PIDS; do
+    echo $PID | sudo tee -a "${CONT_CGROUP_DIR}/cgroup.procs" > /dev/null || exit 5
+done
+
+exit 0
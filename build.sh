@@ -1,21 +1,43 @@
 #! /bin/bash
 
+# usage: ./build.sh [--multicall]
+# with --multicall aucont tools in bin are symlinks to static multi-call `aucont`
+# binary instead of standalone tools linked with libaucont_common
+
+MULTICALL=0
+if [ "$1" == "--multicall" ]; then
+    MULTICALL=1
+fi
+
 mkdir -p bin
 cd src
 
-cd libaucont_common
-pwd
-echo ============ Building libaucont_file ============
-make clean all
-cd ../
+if [ $MULTICALL -eq 0 ]; then
+    cd libaucont_common
+    pwd
+    echo ============ Building libaucont_file ============
+    make clean all
+    cd ../
+fi
 
 for d in aucont_*/; do
+    if [ $MULTICALL -eq 1 ] && ! grep -q StaticMakefile.mk "$d/Makefile"; then
+        continue
+    fi
     cd "$d"
     echo ============ Building $d ============
     make clean all
     cd ../
 done
+
+cd aucont
+echo ============ Building aucont ============
+make clean all
+if [ $MULTICALL -eq 1 ]; then
+    make links
+fi
+cd ../
 cd ../
 
 chmod +x bin/*.sh
-rm bin/*.o
\ No newline at end of file
+rm -f bin/*.o
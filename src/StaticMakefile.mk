@@ -0,0 +1,22 @@
+# common part for tiny static helpers (no libaucont_common, no C++ runtime),
+# which are exec'd in place of full aucont tools
+# moust be included after specifying `BIN_NAME`
+
+BIN_REL_DIR = ../../bin
+BIN_DIR = $(realpath $(BIN_REL_DIR))
+CXX = g++
+CXX_FLAGS = -std=c++11 -Wall -Werror -Wextra -pedantic-errors -Os -static -s -fno-exceptions -fno-rtti
+SOURCES = $(wildcard src/*.cpp)
+
+.PHONY: all
+all: $(BIN_DIR) $(BIN_DIR)/$(BIN_NAME)
+
+$(BIN_DIR):
+	mkdir $(BIN_DIR)
+
+$(BIN_DIR)/$(BIN_NAME): $(SOURCES)
+	$(CXX) $(CXX_FLAGS) $(SOURCES) -o $@
+
+.PHONY: clean
+clean:
+	rm -rf $(BIN_DIR)/$(BIN_NAME)
@@ -0,0 +1,81 @@
+/**
+ * Multi-call `aucont` binary: all aucont tools linked together (statically),
+ * so short commands don't pay for dynamic loading. Tool is chosen by first
+ * argument (`aucont list`) or by name the binary is run with (`aucont_list`
+ * symlink to `aucont`).
+ */
+
+#include <iostream>
+#include <string>
+
+#include <cstring>
+
+#define AUCONT_TOOLS(X) \
+    X(start) X(stop) X(exec) X(list) X(logs) X(pause) X(resume) X(events) X(autoscale) \
+    X(checkpoint) X(restore)
+
+#define AUCONT_DECLARE_TOOL(tool) int aucont_##tool##_main(int argc, char* argv[]);
+AUCONT_TOOLS(AUCONT_DECLARE_TOOL)
+
+namespace
+{
+    typedef int (*tool_main_t)(int, char**);
+
+    struct tool_t
+    {
+        const char* name;
+        tool_main_t main;
+    };
+
+#define AUCONT_TOOL_ENTRY(tool) { #tool, aucont_##tool##_main },
+    const tool_t tools[] = { AUCONT_TOOLS(AUCONT_TOOL_ENTRY) };
+
+    const char tool_prefix[] = "aucont_";
+
+    tool_main_t find_tool(const char* name)
+    {
+        for (const auto& tool : tools) {
+            if (!std::strcmp(tool.name, name)) {
+                return tool.main;
+            }
+        }
+        return nullptr;
+    }
+
+    void print_usage()
+    {
+        std::cout << "USAGE: aucont TOOL [ARGS]" << std::endl
+                  << "   or: aucont_TOOL [ARGS] (symlink to aucont)" << std::endl
+                  << "TOOL is one of:";
+        for (const auto& tool : tools) {
+            std::cout << " " << tool.name;
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* name = std::strrchr(argv[0], '/');
+    name = name == nullptr ? argv[0] : name + 1;
+    if (!std::strncmp(name, tool_prefix, sizeof(tool_prefix) - 1)) {
+        auto tool_main = find_tool(name + sizeof(tool_prefix) - 1);
+        if (tool_main != nullptr) {
+            return tool_main(argc, argv);
+        }
+    }
+
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    auto tool_main = find_tool(argv[1]);
+    if (tool_main == nullptr) {
+        std::cout << "Unknown tool: " << argv[1] << std::endl;
+        print_usage();
+        return 1;
+    }
+    // tool sees `aucont list ARGS` as `aucont ARGS`, like standalone `aucont_list ARGS`
+    argv[1] = argv[0];
+    return tool_main(argc - 1, argv + 1);
+}
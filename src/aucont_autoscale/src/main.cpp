@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+#include <cstring>
+#include <cctype>
+#include <ctime>
+
+#include <aucont_common.h>
+#include <aucont_runtime.h>
+
+namespace
+{
+    void print_usage() {
+        std::cout << "USAGE: ./aucont_autoscale [--interval MS] [--cpu-budget PERC] [--mem-budget MB] [--timeout SEC]"
+                  << std::endl;
+        std::cout << "       Adapts limits of containers started with --cpu-range or --mem-range to their load"
+                  << " (pressure, throttled time and usage) and logs every change to stdout" << std::endl;
+        std::cout << "       --interval MS - how often limits are revised, 1000 by default" << std::endl;
+        std::cout << "       --cpu-budget PERC - max sum of adaptive cpu limits, percent of host cpu, 100 by default"
+                  << std::endl;
+        std::cout << "       --mem-budget MB - max sum of adaptive memory limits, host memory size by default"
+                  << std::endl;
+        std::cout << "       --timeout SEC - stop after SEC seconds" << std::endl;
+    }
+
+    bool is_number(const char* str)
+    {
+        return *str != '\0' && std::all_of(str, str + strlen(str), [](char c){ return std::isdigit(c); });
+    }
+
+    void print_decision(const aucont::limit_decision& decision)
+    {
+        char time_str[32];
+        time_t now = time(NULL);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&now));
+        std::cout << time_str << " " << decision.pid << " " << decision.resource << " "
+                  << decision.old_limit << " -> " << decision.new_limit << " (" << decision.reason << ")" << std::endl;
+    }
+}
+
+int AUCONT_TOOL_MAIN(autoscale)(int argc, char* argv[]) {
+    aucont::autoscale_options opts;
+    int timeout_ms = -1;
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc || !is_number(argv[i + 1])) {
+            print_usage();
+            exit(1);
+        }
+        long value = std::atol(argv[i + 1]);
+        if (!std::strcmp(argv[i], "--interval")) {
+            opts.interval_ms = value;
+        } else if (!std::strcmp(argv[i], "--cpu-budget")) {
+            opts.cpu_budget = value;
+        } else if (!std::strcmp(argv[i], "--mem-budget")) {
+            opts.mem_budget = static_cast<uint64_t>(value) * 1024 * 1024;
+        } else if (!std::strcmp(argv[i], "--timeout")) {
+            timeout_ms = value * 1000;
+        } else {
+            print_usage();
+            exit(1);
+        }
+    }
+
+    aucont::Runtime runtime(aucont::get_exe_dir());
+    auto status = runtime.autoscale(opts, [](const aucont::limit_decision& decision) {
+        print_decision(decision);
+        return bool(std::cout);
+    }, timeout_ms);
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
+    return 0;
+}
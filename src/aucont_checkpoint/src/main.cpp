@@ -0,0 +1,56 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+
+#include <aucont_common.h>
+#include <aucont_runtime.h>
+
+namespace
+{
+    void print_usage() {
+        std::cout << "USAGE: ./aucont_checkpoint [--pre-dumps N] [--leave-running] [--name NAME] PID" << std::endl;
+        std::cout << "       Dumps container with CRIU into snapshot in memory (tmpfs) and prints snapshot path" << std::endl;
+        std::cout << "       --pre-dumps N - copy memory N times while container runs, so final dump, "
+                  << "which stops it, writes only pages changed since last copy" << std::endl;
+        std::cout << "       --leave-running - container keeps running after dump (it's killed by default)" << std::endl;
+        std::cout << "       --name NAME - snapshot name, PID-UNIXTIME by default" << std::endl;
+    }
+
+    bool is_number(const std::string& str)
+    {
+        return !str.empty() && std::all_of(str.begin(), str.end(), [](char c){ return std::isdigit(c); });
+    }
+}
+
+int AUCONT_TOOL_MAIN(checkpoint)(int argc, char* argv[]) {
+    aucont::checkpoint_options opts;
+    int i = 1;
+    for (; i < argc - 1; ++i) {
+        if (!std::strcmp(argv[i], "--pre-dumps") && i + 2 < argc && is_number(argv[i + 1])) {
+            opts.pre_dumps = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--leave-running")) {
+            opts.leave_running = true;
+        } else if (!std::strcmp(argv[i], "--name") && i + 2 < argc) {
+            opts.name = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (argc - i != 1 || !is_number(argv[i])) {
+        print_usage();
+        exit(1);
+    }
+
+    aucont::Runtime runtime(aucont::get_exe_dir());
+    std::string snapshot;
+    auto status = runtime.checkpoint(std::stoi(argv[i]), opts, snapshot);
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
+    std::cout << snapshot << std::endl;
+    return 0;
+}
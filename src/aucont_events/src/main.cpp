@@ -0,0 +1,70 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <set>
+#include <algorithm>
+
+#include <cstring>
+#include <cctype>
+
+#include <sys/types.h>
+
+#include <aucont_common.h>
+#include <aucont_runtime.h>
+
+namespace
+{
+    void print_usage() {
+        std::cout << "USAGE: ./aucont_events [--timeout SEC] [PID[,PID...]]" << std::endl;
+        std::cout << "       Prints container events (start, exec, exit, freeze, thaw, oom, throttle) as they happen, "
+                  << "one JSON object per line; only events of given containers are printed if PIDs are given" << std::endl;
+        std::cout << "       --timeout SEC - stop watching after SEC seconds" << std::endl;
+    }
+
+    bool is_number(const std::string& str)
+    {
+        return !str.empty() && std::all_of(str.begin(), str.end(), [](char c){ return std::isdigit(c); });
+    }
+}
+
+int AUCONT_TOOL_MAIN(events)(int argc, char* argv[]) {
+    int timeout_ms = -1;
+    int i = 1;
+    if (i < argc && !std::strcmp(argv[i], "--timeout")) {
+        if (i + 1 >= argc || !is_number(argv[i + 1])) {
+            print_usage();
+            exit(1);
+        }
+        timeout_ms = std::atoi(argv[i + 1]) * 1000;
+        i += 2;
+    }
+    if (argc - i > 1) {
+        print_usage();
+        exit(1);
+    }
+    std::set<pid_t> pids;
+    if (argc - i == 1) {
+        std::stringstream ss(argv[i]);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!is_number(item)) {
+                print_usage();
+                exit(1);
+            }
+            pids.insert(std::stoi(item));
+        }
+    }
+
+    aucont::Runtime runtime(aucont::get_exe_dir());
+    auto status = runtime.watch([&pids](const aucont::event_t& event) {
+        if (pids.empty() || pids.count(event.pid) != 0) {
+            // flushed right away: stream is usually read by another program
+            std::cout << event.json << std::endl;
+        }
+        return bool(std::cout);
+    }, timeout_ms);
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include "fanout.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cerrno>
+#include <csignal>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace aucont
+{
+    using std::string;
+    using std::vector;
+    using std::chrono::steady_clock;
+
+    namespace
+    {
+        /**
+         * Command execution in one container
+         */
+        struct exec_job
+        {
+            container_t cont;
+            pid_t pid;
+            int pidfd;
+            int out_fd;
+            int err_fd;
+            string out_buf;
+            string err_buf;
+            steady_clock::time_point deadline;
+            bool exited;
+            bool timed_out;
+            int exit_code;
+            string error; // why command couldn't be run or awaited, empty if it could
+
+            explicit exec_job(const container_t& cont)
+            : cont(cont), pid(-1), pidfd(-1), out_fd(-1), err_fd(-1),
+              exited(false), timed_out(false), exit_code(0)
+            {}
+
+            bool done() const
+            {
+                return exited && out_fd < 0 && err_fd < 0;
+            }
+        };
+
+        /**
+         * Starts command in container of job; failure (e.g. container has exited
+         * since it was listed) is recorded in job, others go on
+         */
+        void start_job(Runtime& runtime, exec_job& job, const vector<string>& args, int timeout_ms)
+        {
+            int out_pipe[2];
+            int err_pipe[2];
+            if (pipe2(out_pipe, O_CLOEXEC) != 0 || pipe2(err_pipe, O_CLOEXEC) != 0) {
+                stdlib_error("Can't create output pipes");
+            }
+            int null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if (null_fd < 0) {
+                stdlib_error("Can't open /dev/null");
+            }
+            exec_options exec_opts;
+            exec_opts.stdin_fd = null_fd;
+            exec_opts.stdout_fd = out_pipe[1];
+            exec_opts.stderr_fd = err_pipe[1];
+            // own process group, so timed out command is killed with its helper
+            exec_opts.new_pgroup = true;
+            exec_handle handle;
+            auto status = runtime.exec(job.cont, args, exec_opts, handle);
+            close(null_fd);
+            close(out_pipe[1]);
+            close(err_pipe[1]);
+            if (!status.ok()) {
+                close(out_pipe[0]);
+                close(err_pipe[0]);
+                job.error = status.msg;
+                job.exited = true;
+                return;
+            }
+            job.pid = handle.pid;
+            job.pidfd = handle.pidfd;
+            job.out_fd = out_pipe[0];
+            job.err_fd = err_pipe[0];
+            fcntl(job.out_fd, F_SETFL, O_NONBLOCK);
+            fcntl(job.err_fd, F_SETFL, O_NONBLOCK);
+            job.deadline = steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        }
+
+        /**
+         * Prints complete lines from buffer (or everything if `all`) with container prefix
+         */
+        void flush_lines(const exec_job& job, string& buf, std::ostream& out, bool all)
+        {
+            size_t start = 0;
+            size_t end;
+            while ((end = buf.find('\n', start)) != string::npos) {
+                out << "[" << job.cont.pid << "] " << buf.substr(start, end - start) << "\n";
+                start = end + 1;
+            }
+            buf.erase(0, start);
+            if (all && !buf.empty()) {
+                out << "[" << job.cont.pid << "] " << buf << "\n";
+                buf.clear();
+            }
+            out.flush();
+        }
+
+        /**
+         * Reads available output; closes fd on EOF or if `final` (command is
+         * already gone and nobody is expected to write more)
+         */
+        void read_output(exec_job& job, int& fd, string& buf, std::ostream& out, bool final)
+        {
+            char chunk[4096];
+            while (true) {
+                ssize_t ret = read(fd, chunk, sizeof(chunk));
+                if (ret > 0) {
+                    buf.append(chunk, ret);
+                    continue;
+                }
+                if (ret < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (ret == 0 || (ret < 0 && errno != EAGAIN) || final) {
+                    flush_lines(job, buf, out, true);
+                    close(fd);
+                    fd = -1;
+                    return;
+                }
+                break;
+            }
+            flush_lines(job, buf, out, false);
+        }
+
+        void reap_job(Runtime& runtime, exec_job& job)
+        {
+            exec_handle handle;
+            handle.pid = job.pid;
+            handle.pidfd = job.pidfd;
+            auto status = runtime.wait_exec(handle, -1, job.exit_code);
+            if (!status.ok()) {
+                job.error = status.msg;
+            }
+            job.exited = true;
+            job.pidfd = -1;
+            if (job.out_fd >= 0) read_output(job, job.out_fd, job.out_buf, std::cout, true);
+            if (job.err_fd >= 0) read_output(job, job.err_fd, job.err_buf, std::cerr, true);
+        }
+    }
+
+    int exec_fanout(Runtime& runtime, const vector<container_t>& conts, const vector<string>& args,
+                    size_t parallelism, int timeout_ms)
+    {
+        vector<exec_job> jobs(conts.begin(), conts.end());
+        size_t next = 0;
+        vector<size_t> running;
+        while (next < jobs.size() || !running.empty()) {
+            while (running.size() < parallelism && next < jobs.size()) {
+                start_job(runtime, jobs[next], args, timeout_ms);
+                if (!jobs[next].done()) {
+                    running.push_back(next);
+                }
+                ++next;
+            }
+
+            vector<struct pollfd> pfds;
+            vector<size_t> owners;
+            int poll_timeout = -1;
+            auto now = steady_clock::now();
+            for (auto i : running) {
+                const auto& job = jobs[i];
+                for (int fd : { job.out_fd, job.err_fd, job.pidfd }) {
+                    if (fd >= 0) {
+                        pfds.push_back({ fd, POLLIN, 0 });
+                        owners.push_back(i);
+                    }
+                }
+                if (timeout_ms > 0 && !job.timed_out) {
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(job.deadline - now).count();
+                    left = left < 0 ? 0 : left;
+                    poll_timeout = poll_timeout < 0 || left < poll_timeout ? left : poll_timeout;
+                }
+            }
+            if (poll(pfds.data(), pfds.size(), poll_timeout) < 0 && errno != EINTR) {
+                stdlib_error("Poll failed");
+            }
+
+            for (size_t k = 0; k < pfds.size(); ++k) {
+                if (pfds[k].revents == 0) {
+                    continue;
+                }
+                auto& job = jobs[owners[k]];
+                if (pfds[k].fd == job.out_fd) {
+                    read_output(job, job.out_fd, job.out_buf, std::cout, false);
+                } else if (pfds[k].fd == job.err_fd) {
+                    read_output(job, job.err_fd, job.err_buf, std::cerr, false);
+                } else if (pfds[k].fd == job.pidfd) {
+                    reap_job(runtime, job);
+                }
+            }
+
+            now = steady_clock::now();
+            vector<size_t> still_running;
+            for (auto i : running) {
+                auto& job = jobs[i];
+                if (timeout_ms > 0 && !job.exited && !job.timed_out && now >= job.deadline) {
+                    job.timed_out = true;
+                    kill(-job.pid, SIGKILL);
+                }
+                if (!job.done()) {
+                    still_running.push_back(i);
+                }
+            }
+            running.swap(still_running);
+        }
+
+        int result = 0;
+        for (const auto& job : jobs) {
+            std::cerr << "[" << job.cont.pid << "] ";
+            if (!job.error.empty()) {
+                std::cerr << "failed: " << job.error << std::endl;
+            } else if (job.timed_out) {
+                std::cerr << "timed out" << std::endl;
+            } else {
+                std::cerr << "exit code " << job.exit_code << std::endl;
+            }
+            if (!job.error.empty() || job.timed_out || job.exit_code != 0) {
+                result = 1;
+            }
+        }
+        return result;
+    }
+}
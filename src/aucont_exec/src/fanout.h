@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <aucont_runtime.h>
+
+namespace aucont
+{
+    /**
+     * Runs command in all given containers concurrently (at most `parallelism`
+     * at once). Output lines of every container are prefixed with "[PID] ",
+     * exit code of command in every container is reported to stderr at the end;
+     * container, where command can't be run or awaited, is reported as failed
+     * there and doesn't stop others
+     * @param args       command and its arguments
+     * @param timeout_ms per container timeout, command is killed after it; 0 means no timeout
+     * @return 0 if command succeeded in all containers, 1 otherwise
+     */
+    int exec_fanout(Runtime& runtime, const std::vector<container_t>& conts, const std::vector<std::string>& args,
+                    size_t parallelism, int timeout_ms);
+}
@@ -1,112 +1,183 @@
 #include <iostream>
 #include <sstream>
-#include <array>
-#include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include <cstring>
+#include <cctype>
+#include <cstdlib>
 
-#include <fcntl.h>
 #include <unistd.h>
-#include <sched.h>
-#include <sys/syscall.h>
-#include <sys/stat.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 
 #include <aucont_common.h>
+#include <aucont_runtime.h>
+
+#include "fanout.h"
 
 namespace 
 {
+    const size_t default_parallelism = 16;
+
     void print_usage() 
     {
         std::cout << "usage: ./aucont_exec PID CMD [ARGS]" << std::endl;
+        std::cout << "       ./aucont_exec --fast PID CMD [ARGS]" << std::endl;
+        std::cout << "       ./aucont_exec [-j N] [--timeout SEC] (--all | --filter cpu=CPU_PERC | PID,PID,...) "
+                  << "CMD [ARGS]" << std::endl;
         std::cout << "    PID - container init process pid in its parent PID namespace" << std::endl;
         std::cout << "    CMD - command to run inside container" << std::endl;
         std::cout << "    ARGS - arguments for CMD" << std::endl;
+        std::cout << "    --fast - run command by exec agent of container started with --exec-agent (no namespaces are "
+                  << "joined on host), exit with command exit code" << std::endl;
+        std::cout << "    --all - run command in every running (not paused) container" << std::endl;
+        std::cout << "    --filter cpu=CPU_PERC - run command in containers with given cpu limit" << std::endl;
+        std::cout << "    PID,PID,... - run command in listed containers" << std::endl;
+        std::cout << "    -j N - run command in at most N containers at once (" << default_parallelism
+                  << " by default)" << std::endl;
+        std::cout << "    --timeout SEC - kill command if it runs longer than SEC seconds in some container"
+                  << std::endl;
+        std::cout << "  With single container exit code is command exit code. With several containers output lines are "
+                  << "prefixed with \"[PID] \", exit code (or failure to run command) for every container is printed "
+                  << "to stderr and exit code is 0 only if command succeeded in all of them" << std::endl;
     }
 
-    void unshare_ns(std::string ns, std::string pid_str)
+    bool is_number(const char* str)
     {
-        auto f = "/proc/" + pid_str + "/ns/" + ns;
-        int fd = open(f.c_str(), O_RDONLY);
-        if (fd < 0) {
-            aucont::stdlib_error("Can't open ns fd [ " + f + " ]");
-        }
-        if (setns(fd, 0) < 0) {
-            close(fd);
-            aucont::stdlib_error("Can't set ns: " + ns);
+        return *str != '\0' && std::all_of(str, str + strlen(str), [](char c){ return std::isdigit(c); });
+    }
+
+    std::vector<pid_t> parse_pids(const std::string& list)
+    {
+        std::vector<pid_t> pids;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!is_number(item.c_str())) {
+                aucont::error("Bad container pid: " + item);
+            }
+            pids.push_back(std::stoi(item));
         }
-        close(fd);
+        return pids;
     }
 }
 
 
-int main(int argc, char* argv[]) {
+int AUCONT_TOOL_MAIN(exec)(int argc, char* argv[]) {
     if (argc < 3) {
         print_usage();
+        exit(1);
     }
-    auto exe_path = aucont::get_file_real_dir(argv[0]);
-    aucont::set_aucont_root(exe_path);
+    aucont::Runtime runtime(aucont::get_exe_dir());
 
-    std::string cont_pid_str = std::string(argv[1]);
-    // loading container info
-    auto cont = aucont::get_container(stoi(cont_pid_str));
-    if (cont.pid == -1) {
-        aucont::error("No container running with pid (invalid pid) = " + cont_pid_str);
+    // single container: command runs with inherited stdio, like it was run from host
+    if (is_number(argv[1])) {
+        aucont::container_t cont;
+        auto status = runtime.get(std::stoi(argv[1]), cont);
+        if (!status.ok()) {
+            aucont::error("No container running with pid (invalid pid) = " + std::string(argv[1]));
+        }
+        aucont::exec_handle handle;
+        int exit_code = 0;
+        status = runtime.exec(cont, std::vector<std::string>(argv + 2, argv + argc), aucont::exec_options(), handle);
+        if (status.ok()) {
+            status = runtime.wait_exec(handle, -1, exit_code);
+        }
+        if (!status.ok()) {
+            aucont::error(status.msg);
+        }
+        return exit_code;
     }
 
-    int synch_pipe[2];
-    if (pipe2(synch_pipe, O_CLOEXEC) < 0) {
-        aucont::stdlib_error("pipe");
+    // exec agent of container forks command, this process just waits for exit code
+    if (!std::strcmp(argv[1], "--fast")) {
+        if (argc < 4 || !is_number(argv[2])) {
+            print_usage();
+            exit(1);
+        }
+        // frozen agent would accept request and never answer, so paused container is refused
+        aucont::container_t cont;
+        auto status = runtime.get(std::stoi(argv[2]), cont);
+        if (!status.ok()) {
+            aucont::error("No container running with pid (invalid pid) = " + std::string(argv[2]));
+        }
+        aucont::exec_options exec_opts;
+        exec_opts.agent = true;
+        aucont::exec_handle handle;
+        int exit_code = 0;
+        status = runtime.exec(cont, std::vector<std::string>(argv + 3, argv + argc), exec_opts, handle);
+        if (status.ok()) {
+            status = runtime.wait_exec(handle, -1, exit_code);
+        }
+        if (!status.ok()) {
+            aucont::error(status.msg);
+        }
+        return exit_code;
     }
 
-    // applying user and pid namespace and forking first
-    // unsharing user first because it sets proper permissions for next unshare
-    unshare_ns("user", cont_pid_str); 
-    unshare_ns("pid", cont_pid_str);
-
-    auto cmd_pid = fork();
-    if (cmd_pid < 0) {
-        aucont::stdlib_error("Fork failed");
-    } else if (cmd_pid > 0) {
-        close(synch_pipe[0]);
-
-        // setting up cgroup if needed
-        if (cont.cpu_perc != 100) {
-            auto cg_tasks_file = aucont::get_cgrouph_path() + "/" + aucont::get_cgroup_for_cpuperc(cont.cpu_perc) + "/tasks";
-            std::ofstream out(cg_tasks_file, std::ios_base::out | std::ios_base::app);
-            out << cmd_pid;
-            out.close();
+    size_t parallelism = default_parallelism;
+    int timeout_ms = 0;
+    bool all = false;
+    int cpu_filter = -1;
+    std::vector<pid_t> pids;
+    int i = 1;
+    for (; i < argc && pids.empty() && !all && cpu_filter < 0; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--timeout" || arg == "--filter") && i + 1 >= argc) {
+            aucont::error("No arguments specified for " + arg);
         }
-        aucont::write_to_pipe(synch_pipe[1], true);
-        close(synch_pipe[1]);
-        
-        if (waitpid(cmd_pid, NULL, 0) < 0) {
-            aucont::stdlib_error("Waitpid failed");
+        if (arg == "-j") {
+            if (!is_number(argv[i + 1]) || std::atoi(argv[i + 1]) < 1) {
+                aucont::error("Parallelism must be a positive number");
+            }
+            parallelism = std::atoi(argv[++i]);
+        } else if (arg == "--timeout") {
+            if (!is_number(argv[i + 1])) {
+                aucont::error("Timeout must be a number of seconds");
+            }
+            timeout_ms = std::atoi(argv[++i]) * 1000;
+        } else if (arg == "--all") {
+            all = true;
+        } else if (arg == "--filter") {
+            std::string filter = argv[++i];
+            if (filter.compare(0, 4, "cpu=") != 0 || !is_number(filter.c_str() + 4)) {
+                aucont::error("Unsupported filter: " + filter);
+            }
+            cpu_filter = std::atoi(filter.c_str() + 4);
+        } else {
+            pids = parse_pids(arg);
         }
-        exit(0);
     }
-    close(synch_pipe[1]);
-
-    unshare_ns("net", cont_pid_str);
-    unshare_ns("ipc", cont_pid_str);
-    unshare_ns("uts", cont_pid_str);
-    unshare_ns("mnt", cont_pid_str);
-
-    // waiting for cgroup to be configured 
-    aucont::read_from_pipe<bool>(synch_pipe[0]);
-    close(synch_pipe[0]);
+    if (i >= argc) {
+        print_usage();
+        exit(1);
+    }
 
-    const int max_arg_num = 100;
-    char* cmd = argv[2];
-    char* args[max_arg_num];
-    for (int j = 2; j < argc; ++j) {
-        args[j - 2] = argv[j];
+    // registry is read only once for all containers
+    std::vector<aucont::container_t> running;
+    auto status = runtime.list(running);
+    if (!status.ok()) {
+        aucont::error(status.msg);
     }
-    args[argc - 2] = NULL;
-    if (execvp(cmd, args) < 0) {
-        aucont::stdlib_error("exec failed");
+    std::vector<aucont::container_t> conts;
+    if (all || cpu_filter >= 0) {
+        for (const auto& cont : running) {
+            if (!cont.paused && (all || cont.cpu_perc == cpu_filter)) {
+                conts.push_back(cont);
+            }
+        }
+    } else {
+        for (auto pid : pids) {
+            auto it = std::find(running.begin(), running.end(), aucont::container_t(pid));
+            if (it == running.end()) {
+                aucont::error("No container running with pid (invalid pid) = " + std::to_string(pid));
+            }
+            if (it->paused) {
+                aucont::error("Container " + std::to_string(pid) + " is paused, resume it first");
+            }
+            conts.push_back(*it);
+        }
     }
-    return 0;
+    return aucont::exec_fanout(runtime, conts, std::vector<std::string>(argv + i, argv + argc), parallelism, timeout_ms);
 }
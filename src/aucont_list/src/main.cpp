@@ -2,21 +2,39 @@
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
+#include <vector>
 
 #include <csignal>
 #include <cerrno>
 
 #include <aucont_common.h>
+#include <aucont_runtime.h>
 
 
-int main(int argc, char* argv[]) {
+int AUCONT_TOOL_MAIN(list)(int argc, char* argv[]) {
     // preparing aucont common resources path
-    aucont::set_aucont_root(aucont::get_file_real_dir(argv[0]));
+    aucont::Runtime runtime(aucont::get_exe_dir());
 
-    auto conts = aucont::get_containers();
+    std::vector<aucont::container_t> conts;
+    auto status = runtime.list(conts);
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
     for (auto cont : conts) {
-        std::cout << cont.pid << std::endl;
+        std::cout << cont.pid;
+        if (cont.paused) {
+            std::cout << " paused";
+        }
+        if (cont.readiness == aucont::readiness_starting) {
+            std::cout << " starting";
+        } else if (cont.readiness == aucont::readiness_ready) {
+            std::cout << " ready";
+        } else if (cont.readiness == aucont::readiness_failed) {
+            std::cout << " not-ready";
+        }
+        std::cout << std::endl;
     }
     (void) argc;
+    (void) argv;
     return 0;
 }
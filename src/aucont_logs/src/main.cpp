@@ -0,0 +1,133 @@
+#include <iostream>
+#include <string>
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <aucont_common.h>
+#include <aucont_runtime.h>
+
+namespace
+{
+    const int follow_check_interval_ms = 1000;
+
+    void print_usage()
+    {
+        std::cout << "USAGE: ./aucont_logs PID [--follow]" << std::endl;
+        std::cout << "       PID - id of container started with `-d --log`" << std::endl;
+        std::cout << "       --follow - keep printing new output until container exits" << std::endl;
+    }
+
+    /**
+     * copies everything, what is available in fd now, to stdout
+     */
+    void drain(int fd)
+    {
+        char buf[64 * 1024];
+        while (true) {
+            ssize_t ret = read(fd, buf, sizeof(buf));
+            if (ret == 0) {
+                return;
+            } else if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                aucont::stdlib_error("Can't read log");
+            }
+            ssize_t off = 0;
+            while (off < ret) {
+                ssize_t written = write(STDOUT_FILENO, buf + off, ret - off);
+                if (written < 0) {
+                    aucont::stdlib_error("Can't write log to stdout");
+                }
+                off += written;
+            }
+        }
+    }
+
+    bool same_file(int fd, const std::string& path)
+    {
+        struct stat fd_st, path_st;
+        return fstat(fd, &fd_st) == 0 && stat(path.c_str(), &path_st) == 0 &&
+               fd_st.st_ino == path_st.st_ino && fd_st.st_dev == path_st.st_dev;
+    }
+
+    /**
+     * prints new output as it is written to log, following log rotation
+     */
+    void follow(int fd, const std::string& path, pid_t pid)
+    {
+        int ino_fd = inotify_init1(IN_CLOEXEC);
+        if (ino_fd < 0) {
+            aucont::stdlib_error("Can't init inotify");
+        }
+        std::string dir = path.substr(0, path.find_last_of('/'));
+        if (inotify_add_watch(ino_fd, dir.c_str(), IN_MODIFY | IN_CREATE | IN_MOVED_FROM) < 0) {
+            aucont::stdlib_error("Can't watch log directory " + dir);
+        }
+        char events[4096];
+        while (true) {
+            drain(fd);
+            if (!same_file(fd, path)) { // log was rotated
+                int new_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (new_fd >= 0) {
+                    drain(fd);
+                    close(fd);
+                    fd = new_fd;
+                    continue;
+                }
+            }
+            struct pollfd pfd = { ino_fd, POLLIN, 0 };
+            int ret = poll(&pfd, 1, follow_check_interval_ms);
+            if (ret < 0 && errno != EINTR) {
+                aucont::stdlib_error("Can't wait for log changes");
+            } else if (ret > 0) {
+                if (read(ino_fd, events, sizeof(events)) < 0 && errno != EINTR) {
+                    aucont::stdlib_error("Can't read inotify events");
+                }
+            } else if (ret == 0 && kill(pid, 0) < 0 && errno == ESRCH) {
+                // container is gone, collector flushes the rest right after
+                drain(fd);
+                break;
+            }
+        }
+        close(fd);
+        close(ino_fd);
+    }
+}
+
+int AUCONT_TOOL_MAIN(logs)(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3 || (argc == 3 && std::strcmp(argv[2], "--follow"))) {
+        print_usage();
+        exit(1);
+    }
+    aucont::Runtime runtime(aucont::get_exe_dir());
+    pid_t pid = atoi(argv[1]);
+    auto path = runtime.log_path(pid);
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        aucont::stdlib_error("No log for container with pid [ " + std::to_string(pid) + " ]");
+    }
+    int old_fd = open((path + ".1").c_str(), O_RDONLY | O_CLOEXEC);
+    if (old_fd >= 0) {
+        drain(old_fd);
+        close(old_fd);
+    }
+
+    if (argc == 3) {
+        follow(fd, path, pid);
+    } else {
+        drain(fd);
+        close(fd);
+    }
+    return 0;
+}
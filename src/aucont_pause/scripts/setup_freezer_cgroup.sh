@@ -0,0 +1,39 @@
+#! /bin/bash
+
+if [ "$#" -ne 3 ]; then
+    exit 1 # wrong number of arguments
+fi
+
+PIDS=$1
+FREEZER_HIERARCHY_DIR=$2
+CGROUP_NAME=$3
+FREEZER_CGROUP_DIR=${FREEZER_HIERARCHY_DIR}/${CGROUP_NAME}
+
+# mounting freezer hierarchy if needed: v1 freezer controller if kernel
+# has it, plain cgroup2 (with cgroup.freeze) otherwise
+if [ -z "$(mount | grep "$FREEZER_HIERARCHY_DIR")" ]; then
+    mkdir -p "$FREEZER_HIERARCHY_DIR"
+    if grep -qw "^freezer" /proc/cgroups; then
+        sudo mount -t cgroup -ofreezer aucont_freezerh "$FREEZER_HIERARCHY_DIR"
+    else
+        sudo mount -t cgroup2 aucont_freezerh "$FREEZER_HIERARCHY_DIR"
+    fi
+    if [ "$?" -ne "0" ]; then
+        exit 2 # error mounting
+    fi
+fi
+
+# creating cgroup for container if needed
+GID=$(id -g)
+sudo mkdir -p "$FREEZER_CGROUP_DIR" && \
+sudo chown -R $UID:$GID "$FREEZER_CGROUP_DIR"
+if [ "$?" -ne "0" ]; then
+    exit 3
+fi
+
+# moving processes; some of them may exit meanwhile, that is ok
+for PID in $PIDS; do
+    echo $PID | sudo tee -a "${FREEZER_CGROUP_DIR}/cgroup.procs" > /dev/null 2>&1
+done
+
+exit 0
@@ -0,0 +1,312 @@
+/**
+ * Minimal init for container (`aucont_start --init`): runs workload in its own
+ * process group, reaps every child (orphans are reparented to PID 1), forwards
+ * signals to workload process group and exits with workload exit status.
+ * With `aucont_start --exec-agent` it's also exec agent of container: commands
+ * of `aucont_exec --fast` come through inherited listening socket and are forked
+ * right here, already in container namespaces and cgroups (protocol is described
+ * in aucont_agent.h).
+ * Only libc is used to keep it small; it runs from host binary (fexecve), so
+ * image doesn't need to contain it.
+ */
+
+#include <csignal>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+
+namespace
+{
+    // must match aucont_agent.h
+    const char agent_fd_env[] = "AUCONT_AGENT_FD";
+    const size_t max_request_size = 64 * 1024;
+    // connections above it wait in listen backlog
+    const int max_clients = 64;
+
+    /**
+     * Connection of exec agent client
+     */
+    struct agent_client
+    {
+        int fd;    // -1 after client disconnected, while its command is being killed
+        pid_t pid; // command run for client, 0 until request is received
+    };
+
+    agent_client clients[max_clients];
+    int clients_num = 0;
+    char request[max_request_size];
+    char* request_argv[max_request_size + 1]; // every argument takes at least its NUL
+
+    void fail(const char* msg)
+    {
+        const char prefix[] = "aucont_pid1: ";
+        if (write(STDERR_FILENO, prefix, sizeof(prefix) - 1) < 0 ||
+            write(STDERR_FILENO, msg, strlen(msg)) < 0 ||
+            write(STDERR_FILENO, "\n", 1) < 0) {
+            // nothing to do, exiting anyway
+        }
+        _exit(1);
+    }
+
+    int exit_code(const siginfo_t& info)
+    {
+        return info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status;
+    }
+
+    /**
+     * takes exec agent socket from environment, so workload doesn't see it
+     * @return -1 if container has no exec agent
+     */
+    int take_agent_fd()
+    {
+        const char* fd_str = getenv(agent_fd_env);
+        if (fd_str == NULL) {
+            return -1;
+        }
+        int fd = atoi(fd_str);
+        unsetenv(agent_fd_env);
+        if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+            fail("bad exec agent socket");
+        }
+        return fd;
+    }
+
+    void remove_client(int i)
+    {
+        if (clients[i].fd >= 0) {
+            close(clients[i].fd);
+        }
+        clients[i] = clients[--clients_num];
+    }
+
+    void on_command_exit(pid_t pid, int code)
+    {
+        for (int i = 0; i < clients_num; ++i) {
+            if (clients[i].pid != pid) {
+                continue;
+            }
+            if (clients[i].fd >= 0) {
+                int32_t msg = code;
+                if (send(clients[i].fd, &msg, sizeof(msg), MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {
+                    // client is gone, there is nobody to report to
+                }
+            }
+            remove_client(i);
+            return;
+        }
+    }
+
+    /**
+     * Reaps all exited children
+     * @return true if workload is among them
+     */
+    bool reap_children(pid_t workload, int& workload_code)
+    {
+        bool workload_exited = false;
+        while (true) {
+            siginfo_t info;
+            info.si_pid = 0;
+            if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break; // ECHILD: no children left
+            }
+            if (info.si_pid == 0) {
+                break;
+            }
+            if (info.si_pid == workload) {
+                workload_exited = true;
+                workload_code = exit_code(info);
+            } else if (clients_num > 0) {
+                on_command_exit(info.si_pid, exit_code(info));
+            }
+        }
+        return workload_exited;
+    }
+
+    /**
+     * receives request of client and starts its command
+     * @return false if client must be dropped
+     */
+    bool start_command(agent_client& client, const sigset_t& orig_mask)
+    {
+        int fds[3];
+        union {
+            char buf[CMSG_SPACE(sizeof(fds))];
+            struct cmsghdr align;
+        } control;
+        struct iovec iov = { request, sizeof(request) };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        ssize_t len = recvmsg(client.fd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+        if (len < 0 && (errno == EINTR || errno == EAGAIN)) {
+            return true;
+        }
+        struct cmsghdr* cmsg = len > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+        if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+            cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+            return false; // fds, which don't fit, are closed by kernel (MSG_CTRUNC)
+        }
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+        size_t argc = 0;
+        bool valid = (msg.msg_flags & MSG_TRUNC) == 0 && request[len - 1] == '\0';
+        for (ssize_t pos = 0; valid && pos < len; pos += strlen(request + pos) + 1) {
+            request_argv[argc++] = request + pos;
+        }
+        request_argv[argc] = NULL;
+        pid_t pid = valid ? fork() : -1;
+        if (pid == 0) {
+            setpgid(0, 0);
+            for (int i = 0; i < 3; ++i) {
+                if (dup2(fds[i], i) < 0) {
+                    fail("can't redirect command stdio");
+                }
+            }
+            sigprocmask(SIG_SETMASK, &orig_mask, NULL);
+            execvp(request_argv[0], request_argv);
+            fail("can't run command");
+        }
+        for (int i = 0; i < 3; ++i) {
+            close(fds[i]);
+        }
+        if (pid < 0) {
+            return false;
+        }
+        setpgid(pid, pid); // avoid race with child's own setpgid
+        client.pid = pid;
+        return true;
+    }
+
+    /**
+     * handles request or disconnect of client
+     * @return false if client must be dropped
+     */
+    bool on_client(agent_client& client, const sigset_t& orig_mask)
+    {
+        if (client.pid == 0) {
+            return start_command(client, orig_mask);
+        }
+        char buf[64];
+        ssize_t len = recv(client.fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len == 0 || (len < 0 && errno != EINTR && errno != EAGAIN)) {
+            // nobody waits for command anymore; client is dropped, when command is reaped
+            kill(-client.pid, SIGKILL);
+            close(client.fd);
+            client.fd = -1;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fail("USAGE: aucont_pid1 CMD [ARGS]");
+    }
+    int agent_fd = take_agent_fd();
+
+    sigset_t all;
+    sigset_t orig;
+    sigfillset(&all);
+    if (sigprocmask(SIG_BLOCK, &all, &orig) != 0) {
+        fail("can't block signals");
+    }
+    int sig_fd = signalfd(-1, &all, SFD_CLOEXEC);
+    if (sig_fd < 0) {
+        fail("can't create signalfd");
+    }
+
+    // workload is given terminal, if we have it, as it will be in its own process group
+    bool has_tty = isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+
+    pid_t workload = fork();
+    if (workload < 0) {
+        fail("can't fork workload");
+    } else if (workload == 0) {
+        setpgid(0, 0);
+        if (has_tty) {
+            tcsetpgrp(STDIN_FILENO, getpid()); // SIGTTOU is still blocked here
+        }
+        sigprocmask(SIG_SETMASK, &orig, NULL);
+        execvp(argv[1], argv + 1);
+        fail("can't run command");
+    }
+    setpgid(workload, workload); // avoid race with child's own setpgid
+
+    int workload_code = 0;
+    struct pollfd pfds[2 + max_clients];
+    while (true) {
+        int nfds = 0;
+        pfds[nfds++] = { sig_fd, POLLIN, 0 };
+        int agent_idx = -1;
+        if (agent_fd >= 0 && clients_num < max_clients) {
+            agent_idx = nfds;
+            pfds[nfds++] = { agent_fd, POLLIN, 0 };
+        }
+        int first_client = nfds;
+        for (int i = 0; i < clients_num; ++i) {
+            pfds[nfds++] = { clients[i].fd, POLLIN, 0 }; // negative fd is ignored by poll
+        }
+        if (poll(pfds, nfds, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("can't poll");
+        }
+
+        // backwards: removed client is replaced by last one, which is already handled
+        for (int i = clients_num - 1; i >= 0; --i) {
+            if (pfds[first_client + i].revents != 0 && !on_client(clients[i], orig)) {
+                remove_client(i);
+            }
+        }
+        if (agent_idx >= 0 && pfds[agent_idx].revents != 0) {
+            int fd = accept4(agent_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd >= 0) {
+                clients[clients_num++] = { fd, 0 };
+            }
+        }
+        if (pfds[0].revents == 0) {
+            continue;
+        }
+
+        struct signalfd_siginfo sig;
+        ssize_t ret = read(sig_fd, &sig, sizeof(sig));
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("can't read signalfd");
+        }
+        if (ret != sizeof(sig)) {
+            continue;
+        }
+        if (sig.ssi_signo == SIGCHLD) {
+            if (reap_children(workload, workload_code)) {
+                break;
+            }
+            continue;
+        }
+        if (kill(-workload, sig.ssi_signo) != 0 && errno == ESRCH) {
+            // workload may have left its process group
+            kill(workload, sig.ssi_signo);
+        }
+    }
+    // rest of container processes are killed by kernel when PID 1 exits
+    return workload_code;
+}
@@ -0,0 +1,598 @@
+/**
+ * Publishes container ports on host (`aucont_start -p`) and sets priority of
+ * container traffic (`aucont_start --net-prio`). DNAT rules and priority rule
+ * are written to nftables directly through netlink into table `aucont_<pid>`,
+ * which is owned by helper's netlink socket (NFT_TABLE_F_OWNER): kernel
+ * removes it as soon as helper exits. Helper detaches, keeps host ports
+ * bound (so they can't be published twice or taken by host service) and
+ * exits when container init exits. Only libc is used to keep it small.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/pkt_sched.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+#include <linux/netfilter/nf_nat.h>
+
+namespace
+{
+    const int max_ports = 64;
+    const int32_t dstnat_priority = -100; // NF_IP_PRI_NAT_DST
+    const int32_t srcnat_priority = 100;  // NF_IP_PRI_NAT_SRC
+    const int32_t filter_priority = 0;    // NF_IP_PRI_FILTER
+
+    struct port_t
+    {
+        uint16_t host_port;
+        uint16_t cont_port;
+        uint8_t proto;
+    };
+
+    void fail(const char* msg, int err = 0)
+    {
+        char buf[256];
+        int len = std::snprintf(buf, sizeof(buf), "aucont_portmap: %s%s%s\n", msg,
+                                err ? ": " : "", err ? std::strerror(err) : "");
+        if (write(STDERR_FILENO, buf, len) < 0) {
+            // nothing to do, exiting anyway
+        }
+        _exit(1);
+    }
+
+    /**
+     * nf_tables batch under construction
+     */
+    struct batch_t
+    {
+        char data[32 * 1024];
+        size_t len;
+        size_t msg_start;
+        uint32_t seq;
+        uint32_t msgs; // messages, which are acked by kernel (all except batch begin/end)
+    };
+
+    void* put(batch_t& b, const void* data, size_t len)
+    {
+        size_t aligned = NLMSG_ALIGN(len);
+        if (b.len + aligned > sizeof(b.data)) {
+            fail("too many rules");
+        }
+        void* dest = b.data + b.len;
+        std::memset(dest, 0, aligned);
+        if (data != nullptr) {
+            std::memcpy(dest, data, len);
+        }
+        b.len += aligned;
+        return dest;
+    }
+
+    void begin_msg(batch_t& b, uint16_t type, uint16_t flags, uint8_t family, uint16_t res_id = 0)
+    {
+        b.msg_start = b.len;
+        auto hdr = static_cast<nlmsghdr*>(put(b, nullptr, sizeof(nlmsghdr)));
+        hdr->nlmsg_type = type;
+        hdr->nlmsg_flags = NLM_F_REQUEST | flags;
+        hdr->nlmsg_seq = ++b.seq;
+        auto gen = static_cast<nfgenmsg*>(put(b, nullptr, sizeof(nfgenmsg)));
+        gen->nfgen_family = family;
+        gen->version = NFNETLINK_V0;
+        gen->res_id = htons(res_id);
+    }
+
+    void end_msg(batch_t& b)
+    {
+        reinterpret_cast<nlmsghdr*>(b.data + b.msg_start)->nlmsg_len = b.len - b.msg_start;
+    }
+
+    void begin_nft_msg(batch_t& b, uint16_t type, uint16_t flags)
+    {
+        begin_msg(b, (NFNL_SUBSYS_NFTABLES << 8) | type, NLM_F_ACK | NLM_F_CREATE | flags, NFPROTO_IPV4);
+        ++b.msgs;
+    }
+
+    void put_attr(batch_t& b, uint16_t type, const void* data, size_t len)
+    {
+        nlattr attr;
+        attr.nla_len = NLA_HDRLEN + len;
+        attr.nla_type = type;
+        put(b, &attr, sizeof(attr));
+        put(b, data, len);
+    }
+
+    void put_u32(batch_t& b, uint16_t type, uint32_t value)
+    {
+        value = htonl(value);
+        put_attr(b, type, &value, sizeof(value));
+    }
+
+    void put_str(batch_t& b, uint16_t type, const char* str)
+    {
+        put_attr(b, type, str, std::strlen(str) + 1);
+    }
+
+    size_t begin_nest(batch_t& b, uint16_t type)
+    {
+        size_t start = b.len;
+        nlattr attr;
+        attr.nla_len = 0;
+        attr.nla_type = NLA_F_NESTED | type;
+        put(b, &attr, sizeof(attr));
+        return start;
+    }
+
+    void end_nest(batch_t& b, size_t start)
+    {
+        reinterpret_cast<nlattr*>(b.data + start)->nla_len = b.len - start;
+    }
+
+    void put_data(batch_t& b, uint16_t type, const void* data, size_t len)
+    {
+        size_t nest = begin_nest(b, type);
+        put_attr(b, NFTA_DATA_VALUE, data, len);
+        end_nest(b, nest);
+    }
+
+    /**
+     * Rule expressions; every expression is a list element with name and nested data
+     */
+    struct expr_t
+    {
+        size_t elem;
+        size_t data;
+    };
+
+    expr_t begin_expr(batch_t& b, const char* name)
+    {
+        expr_t expr;
+        expr.elem = begin_nest(b, NFTA_LIST_ELEM);
+        put_str(b, NFTA_EXPR_NAME, name);
+        expr.data = begin_nest(b, NFTA_EXPR_DATA);
+        return expr;
+    }
+
+    void end_expr(batch_t& b, expr_t expr)
+    {
+        end_nest(b, expr.data);
+        end_nest(b, expr.elem);
+    }
+
+    void expr_cmp_eq(batch_t& b, uint32_t reg, const void* data, size_t len)
+    {
+        auto expr = begin_expr(b, "cmp");
+        put_u32(b, NFTA_CMP_SREG, reg);
+        put_u32(b, NFTA_CMP_OP, NFT_CMP_EQ);
+        put_data(b, NFTA_CMP_DATA, data, len);
+        end_expr(b, expr);
+    }
+
+    void expr_payload(batch_t& b, uint32_t reg, uint32_t base, uint32_t offset, uint32_t len)
+    {
+        auto expr = begin_expr(b, "payload");
+        put_u32(b, NFTA_PAYLOAD_DREG, reg);
+        put_u32(b, NFTA_PAYLOAD_BASE, base);
+        put_u32(b, NFTA_PAYLOAD_OFFSET, offset);
+        put_u32(b, NFTA_PAYLOAD_LEN, len);
+        end_expr(b, expr);
+    }
+
+    void expr_immediate(batch_t& b, uint32_t reg, const void* data, size_t len)
+    {
+        auto expr = begin_expr(b, "immediate");
+        put_u32(b, NFTA_IMMEDIATE_DREG, reg);
+        put_data(b, NFTA_IMMEDIATE_DATA, data, len);
+        end_expr(b, expr);
+    }
+
+    // fib daddr type local
+    void match_local_daddr(batch_t& b)
+    {
+        auto expr = begin_expr(b, "fib");
+        put_u32(b, NFTA_FIB_DREG, NFT_REG_1);
+        put_u32(b, NFTA_FIB_RESULT, NFT_FIB_RESULT_ADDRTYPE);
+        put_u32(b, NFTA_FIB_FLAGS, NFTA_FIB_F_DADDR);
+        end_expr(b, expr);
+        uint32_t local = RTN_LOCAL; // register holds host order value
+        expr_cmp_eq(b, NFT_REG_1, &local, sizeof(local));
+    }
+
+    // meta l4proto PROTO th dport PORT
+    void match_dport(batch_t& b, uint8_t proto, uint16_t port)
+    {
+        auto expr = begin_expr(b, "meta");
+        put_u32(b, NFTA_META_DREG, NFT_REG_1);
+        put_u32(b, NFTA_META_KEY, NFT_META_L4PROTO);
+        end_expr(b, expr);
+        expr_cmp_eq(b, NFT_REG_1, &proto, sizeof(proto));
+        uint16_t net_port = htons(port);
+        expr_payload(b, NFT_REG_1, NFT_PAYLOAD_TRANSPORT_HEADER, 2, sizeof(net_port));
+        expr_cmp_eq(b, NFT_REG_1, &net_port, sizeof(net_port));
+    }
+
+    // ip daddr ADDR
+    void match_daddr(batch_t& b, in_addr addr)
+    {
+        expr_payload(b, NFT_REG_1, NFT_PAYLOAD_NETWORK_HEADER, offsetof(iphdr, daddr), sizeof(addr));
+        expr_cmp_eq(b, NFT_REG_1, &addr, sizeof(addr));
+    }
+
+    // ip saddr & MASK == ADDR
+    void match_saddr(batch_t& b, in_addr addr, in_addr mask)
+    {
+        expr_payload(b, NFT_REG_1, NFT_PAYLOAD_NETWORK_HEADER, offsetof(iphdr, saddr), sizeof(addr));
+        auto expr = begin_expr(b, "bitwise");
+        uint32_t zero = 0;
+        put_u32(b, NFTA_BITWISE_SREG, NFT_REG_1);
+        put_u32(b, NFTA_BITWISE_DREG, NFT_REG_1);
+        put_u32(b, NFTA_BITWISE_LEN, sizeof(addr));
+        put_data(b, NFTA_BITWISE_MASK, &mask, sizeof(mask));
+        put_data(b, NFTA_BITWISE_XOR, &zero, sizeof(zero));
+        end_expr(b, expr);
+        expr_cmp_eq(b, NFT_REG_1, &addr, sizeof(addr));
+    }
+
+    // dnat to ADDR:PORT
+    void dnat(batch_t& b, in_addr addr, uint16_t port)
+    {
+        uint16_t net_port = htons(port);
+        expr_immediate(b, NFT_REG_1, &addr, sizeof(addr));
+        expr_immediate(b, NFT_REG_2, &net_port, sizeof(net_port));
+        auto expr = begin_expr(b, "nat");
+        put_u32(b, NFTA_NAT_TYPE, NFT_NAT_DNAT);
+        put_u32(b, NFTA_NAT_FAMILY, NFPROTO_IPV4);
+        put_u32(b, NFTA_NAT_REG_ADDR_MIN, NFT_REG_1);
+        put_u32(b, NFTA_NAT_REG_PROTO_MIN, NFT_REG_2);
+        end_expr(b, expr);
+    }
+
+    void masquerade(batch_t& b)
+    {
+        end_expr(b, begin_expr(b, "masq"));
+    }
+
+    // meta iif IFINDEX
+    void match_iif(batch_t& b, uint32_t ifindex)
+    {
+        auto expr = begin_expr(b, "meta");
+        put_u32(b, NFTA_META_DREG, NFT_REG_1);
+        put_u32(b, NFTA_META_KEY, NFT_META_IIF);
+        end_expr(b, expr);
+        expr_cmp_eq(b, NFT_REG_1, &ifindex, sizeof(ifindex));
+    }
+
+    // meta priority set PRIORITY
+    void set_priority(batch_t& b, uint32_t priority)
+    {
+        expr_immediate(b, NFT_REG_1, &priority, sizeof(priority));
+        auto expr = begin_expr(b, "meta");
+        put_u32(b, NFTA_META_KEY, NFT_META_PRIORITY);
+        put_u32(b, NFTA_META_SREG, NFT_REG_1);
+        end_expr(b, expr);
+    }
+
+    void add_chain(batch_t& b, const char* table, const char* chain, const char* type,
+                   uint32_t hook, int32_t priority)
+    {
+        begin_nft_msg(b, NFT_MSG_NEWCHAIN, 0);
+        put_str(b, NFTA_CHAIN_TABLE, table);
+        put_str(b, NFTA_CHAIN_NAME, chain);
+        size_t nest = begin_nest(b, NFTA_CHAIN_HOOK);
+        put_u32(b, NFTA_HOOK_HOOKNUM, hook);
+        put_u32(b, NFTA_HOOK_PRIORITY, static_cast<uint32_t>(priority));
+        end_nest(b, nest);
+        put_str(b, NFTA_CHAIN_TYPE, type);
+        end_msg(b);
+    }
+
+    /**
+     * Starts rule; expressions are added between begin_rule and end_rule
+     */
+    size_t begin_rule(batch_t& b, const char* table, const char* chain)
+    {
+        begin_nft_msg(b, NFT_MSG_NEWRULE, NLM_F_APPEND);
+        put_str(b, NFTA_RULE_TABLE, table);
+        put_str(b, NFTA_RULE_CHAIN, chain);
+        return begin_nest(b, NFTA_RULE_EXPRESSIONS);
+    }
+
+    void end_rule(batch_t& b, size_t exprs)
+    {
+        end_nest(b, exprs);
+        end_msg(b);
+    }
+
+    /**
+     * prerouting, output: fib daddr type local PROTO dport HOST_PORT dnat to CONT_IP:CONT_PORT
+     * postrouting: ip daddr CONT_IP ip saddr 127.0.0.0/8 masquerade (from host loopback)
+     *              ip daddr CONT_IP ip saddr CONT_IP masquerade (container to itself through host)
+     */
+    void add_port_rules(batch_t& b, const char* table, in_addr cont_ip, const port_t* ports, int ports_num)
+    {
+        add_chain(b, table, "prerouting", "nat", NF_INET_PRE_ROUTING, dstnat_priority);
+        add_chain(b, table, "output", "nat", NF_INET_LOCAL_OUT, dstnat_priority);
+        add_chain(b, table, "postrouting", "nat", NF_INET_POST_ROUTING, srcnat_priority);
+
+        for (const char* chain : { "prerouting", "output" }) {
+            for (int i = 0; i < ports_num; ++i) {
+                size_t rule = begin_rule(b, table, chain);
+                match_local_daddr(b);
+                match_dport(b, ports[i].proto, ports[i].host_port);
+                dnat(b, cont_ip, ports[i].cont_port);
+                end_rule(b, rule);
+            }
+        }
+
+        in_addr loopback, loopback_mask, host_mask;
+        inet_aton("127.0.0.0", &loopback);
+        inet_aton("255.0.0.0", &loopback_mask);
+        host_mask.s_addr = INADDR_NONE;
+        for (auto src : { std::make_pair(loopback, loopback_mask), std::make_pair(cont_ip, host_mask) }) {
+            size_t rule = begin_rule(b, table, "postrouting");
+            match_daddr(b, cont_ip);
+            match_saddr(b, src.first, src.second);
+            masquerade(b);
+            end_rule(b, rule);
+        }
+    }
+
+    /**
+     * forward: meta iif HOST_VETH meta priority set PRIORITY
+     * (forwarding has just set priority from TOS, so it's overridden here)
+     */
+    void add_priority_rule(batch_t& b, const char* table, uint32_t host_veth_index, uint32_t priority)
+    {
+        add_chain(b, table, "forward", "filter", NF_INET_FORWARD, filter_priority);
+        size_t rule = begin_rule(b, table, "forward");
+        match_iif(b, host_veth_index);
+        set_priority(b, priority);
+        end_rule(b, rule);
+    }
+
+    /**
+     * Builds whole table in one batch: port rules if any ports are published,
+     * priority rule if priority isn't 0
+     */
+    void build_table(batch_t& b, const char* table, in_addr cont_ip, const port_t* ports, int ports_num,
+                     uint32_t host_veth_index, uint32_t priority)
+    {
+        begin_msg(b, NFNL_MSG_BATCH_BEGIN, 0, AF_UNSPEC, NFNL_SUBSYS_NFTABLES);
+        end_msg(b);
+
+        begin_nft_msg(b, NFT_MSG_NEWTABLE, 0);
+        put_str(b, NFTA_TABLE_NAME, table);
+        put_u32(b, NFTA_TABLE_FLAGS, NFT_TABLE_F_OWNER);
+        end_msg(b);
+
+        if (ports_num > 0) {
+            add_port_rules(b, table, cont_ip, ports, ports_num);
+        }
+        if (priority != 0) {
+            add_priority_rule(b, table, host_veth_index, priority);
+        }
+
+        begin_msg(b, NFNL_MSG_BATCH_END, 0, AF_UNSPEC, NFNL_SUBSYS_NFTABLES);
+        end_msg(b);
+    }
+
+    /**
+     * Sends batch and waits for kernel to ack every message of it
+     * @return 0 or errno of first failed message
+     */
+    int send_batch(int nl_fd, const batch_t& b)
+    {
+        sockaddr_nl kernel;
+        std::memset(&kernel, 0, sizeof(kernel));
+        kernel.nl_family = AF_NETLINK;
+        if (sendto(nl_fd, b.data, b.len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+            return errno;
+        }
+        int result = 0;
+        uint32_t acked = 0;
+        char buf[8192];
+        while (acked < b.msgs) {
+            ssize_t len = recv(nl_fd, buf, sizeof(buf), 0);
+            if (len < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno;
+            }
+            for (auto hdr = reinterpret_cast<nlmsghdr*>(buf); NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
+                if (hdr->nlmsg_type != NLMSG_ERROR) {
+                    continue;
+                }
+                int err = -static_cast<nlmsgerr*>(NLMSG_DATA(hdr))->error;
+                if (result == 0) {
+                    result = err;
+                }
+                ++acked;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * returns skb priority for `--net-prio` value (pfifo_fast and prio qdiscs
+     * map it to band 0, 1 or 2), 0 for `normal`: priority is left as forwarding set it
+     */
+    bool parse_prio(const char* str, uint32_t& priority)
+    {
+        if (!std::strcmp(str, "interactive")) {
+            priority = TC_PRIO_INTERACTIVE;
+        } else if (!std::strcmp(str, "bulk")) {
+            priority = TC_PRIO_BULK;
+        } else if (!std::strcmp(str, "normal")) {
+            priority = 0;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool parse_port(const char* str, port_t& port)
+    {
+        unsigned host_port, cont_port;
+        char proto[4] = "tcp";
+        int consumed = 0;
+        if (std::sscanf(str, "%u:%u%n", &host_port, &cont_port, &consumed) != 2 ||
+            (str[consumed] != '\0' && std::sscanf(str + consumed, "/%3s", proto) != 1) ||
+            host_port < 1 || host_port > 65535 || cont_port < 1 || cont_port > 65535) {
+            return false;
+        }
+        port.host_port = host_port;
+        port.cont_port = cont_port;
+        if (!std::strcmp(proto, "tcp")) {
+            port.proto = IPPROTO_TCP;
+        } else if (!std::strcmp(proto, "udp")) {
+            port.proto = IPPROTO_UDP;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Binds host port, so nobody else can publish or listen on it
+     */
+    void reserve_port(const port_t& port)
+    {
+        int fd = socket(AF_INET, (port.proto == IPPROTO_TCP ? SOCK_STREAM : SOCK_DGRAM) | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            fail("can't create socket", errno);
+        }
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port.host_port);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            char msg[64];
+            std::snprintf(msg, sizeof(msg), "can't reserve host port %u", port.host_port);
+            fail(msg, errno);
+        }
+    }
+
+    /**
+     * Lets host loopback connections to be routed to container (like docker does for its bridge)
+     */
+    void allow_route_localnet(const char* host_veth)
+    {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/proc/sys/net/ipv4/conf/%s/route_localnet", host_veth);
+        int fd = open(path, O_WRONLY | O_CLOEXEC);
+        if (fd < 0 || write(fd, "1", 1) != 1) {
+            fail("can't enable route_localnet", errno);
+        }
+        close(fd);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 5) {
+        fail("USAGE: aucont_portmap CONT_PID HOST_VETH CONT_IP PRIO [HOST_PORT:CONT_PORT[/udp]...]");
+    }
+    pid_t cont_pid = std::atoi(argv[1]);
+    const char* host_veth = argv[2];
+    in_addr cont_ip;
+    if (!inet_aton(argv[3], &cont_ip)) {
+        fail("bad container ip");
+    }
+    uint32_t priority;
+    if (!parse_prio(argv[4], priority)) {
+        fail("bad priority, interactive, normal or bulk expected");
+    }
+    port_t ports[max_ports];
+    int ports_num = argc - 5;
+    if (ports_num > max_ports) {
+        fail("too many ports");
+    }
+    for (int i = 0; i < ports_num; ++i) {
+        if (!parse_port(argv[i + 5], ports[i])) {
+            fail("bad port mapping, HOST_PORT:CONT_PORT[/udp] expected");
+        }
+    }
+    uint32_t host_veth_index = if_nametoindex(host_veth);
+    if (host_veth_index == 0) {
+        fail("can't find host veth", errno);
+    }
+
+    int cont_fd = syscall(SYS_pidfd_open, cont_pid, 0);
+    if (cont_fd < 0) {
+        fail("can't open container pidfd", errno);
+    }
+
+    // keeper (detached child) holds rules and ports; we wait only until they are set up
+    int status_pipe[2];
+    if (pipe2(status_pipe, O_CLOEXEC) != 0) {
+        fail("can't create pipe", errno);
+    }
+    pid_t keeper = fork();
+    if (keeper < 0) {
+        fail("can't fork", errno);
+    } else if (keeper > 0) {
+        close(status_pipe[1]);
+        char ok = 0;
+        ssize_t ret;
+        while ((ret = read(status_pipe[0], &ok, 1)) < 0 && errno == EINTR) {}
+        return ret == 1 && ok ? 0 : 1;
+    }
+    close(status_pipe[0]);
+    setsid();
+
+    for (int i = 0; i < ports_num; ++i) {
+        reserve_port(ports[i]);
+    }
+    if (ports_num > 0) {
+        allow_route_localnet(host_veth);
+    }
+
+    int nl_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+    if (nl_fd < 0) {
+        fail("can't open netfilter netlink socket", errno);
+    }
+    static batch_t batch;
+    char table[32];
+    std::snprintf(table, sizeof(table), "aucont_%d", cont_pid);
+    build_table(batch, table, cont_ip, ports, ports_num, host_veth_index, priority);
+    int err = send_batch(nl_fd, batch);
+    if (err != 0) {
+        fail("can't add nftables rules", err);
+    }
+
+    // caller may capture our output (and wait for EOF)
+    int null_fd = open("/dev/null", O_RDWR);
+    for (int fd : { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO }) {
+        dup2(null_fd, fd);
+    }
+    char ok = 1;
+    if (write(status_pipe[1], &ok, 1) != 1) {
+        _exit(1);
+    }
+    close(status_pipe[1]);
+
+    struct pollfd pfd = { cont_fd, POLLIN, 0 };
+    while (poll(&pfd, 1, -1) < 0 && errno == EINTR) {}
+    // table is removed by kernel together with our netlink socket
+    return 0;
+}
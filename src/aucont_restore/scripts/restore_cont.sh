@@ -0,0 +1,41 @@
+#! /bin/bash
+
+# Restores container process tree from CRIU images; restored processes are
+# left stopped, so host can move them into cgroups before they continue
+# usage: restore_cont.sh IMAGES_DIR CONT_ROOT PIDFILE VETH_PAIR "INHERIT..." OUTPUT
+#   CONT_ROOT - container image, root mount of container is bound from it again
+#   PIDFILE   - where CRIU writes (host) pid of restored container init
+#   VETH_PAIR - CONT_VETH=HOST_VETH: host end of container veth is created
+#               with HOST_VETH name; empty for container without network
+#   INHERIT   - fd[N]:KEY, external object of dump, which is replaced by N-th
+#               fd of CRIU (0 is /dev/null, 1 and 2 are OUTPUT); list isn't
+#               the last argument, so caller quotes it
+#   OUTPUT    - file (or /proc/PID/fd/FD of pipe) for restored stdout and stderr
+
+if [ "$#" -ne 6 ]; then
+    exit 1 # wrong number of arguments
+fi
+
+IMAGES_DIR=$1
+CONT_ROOT=$2
+PIDFILE=$3
+VETH_PAIR=$4
+INHERITS=$5
+OUTPUT=$6
+
+# CRIU keys look like glob patterns
+set -f
+
+CRIU_OPTS="--restore-detached --leave-stopped --tcp-established --file-locks \
+    --ext-unix-sk --manage-cgroups=ignore --ext-mount-map auto"
+if [ -n "$VETH_PAIR" ]; then
+    CRIU_OPTS="${CRIU_OPTS} --veth-pair ${VETH_PAIR}"
+fi
+for INHERIT in $INHERITS; do
+    CRIU_OPTS="${CRIU_OPTS} --inherit-fd ${INHERIT}"
+done
+
+sudo criu restore -D "${IMAGES_DIR}" ${CRIU_OPTS} --root "${CONT_ROOT}" --pidfile "${PIDFILE}" -o restore.log \
+    < /dev/null > "${OUTPUT}" 2>&1
+
+exit $?
@@ -0,0 +1,20 @@
+#! /bin/bash
+
+# Configures host end of veth of restored container: CRIU creates it with
+# temporary name, it's renamed after new container pid
+# usage: restore_net_host.sh TMP_VETH HOST_VETH HOST_IP
+
+if [ "$#" -ne 3 ]; then
+    exit 1
+fi
+
+TMP_VETH=$1
+HOST_VETH=$2
+HOST_IP=$3
+
+sudo ip link set "${TMP_VETH}" name "${HOST_VETH}" && \
+sudo ip addr add "${HOST_IP}/24" dev "${HOST_VETH}" && \
+sudo ip link set "${HOST_VETH}" up && \
+sudo sysctl net.ipv4.conf.all.forwarding=1 > /dev/null
+
+exit $?
@@ -0,0 +1,30 @@
+#include <iostream>
+#include <string>
+
+#include <aucont_common.h>
+#include <aucont_runtime.h>
+
+namespace
+{
+    void print_usage() {
+        std::cout << "USAGE: ./aucont_restore SNAPSHOT" << std::endl;
+        std::cout << "       Restores container from snapshot (path or name, printed by aucont_checkpoint) "
+                  << "as daemonized container and prints its pid" << std::endl;
+    }
+}
+
+int AUCONT_TOOL_MAIN(restore)(int argc, char* argv[]) {
+    if (argc != 2) {
+        print_usage();
+        exit(1);
+    }
+
+    aucont::Runtime runtime(aucont::get_exe_dir());
+    aucont::container_handle handle;
+    auto status = runtime.restore(argv[1], handle);
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
+    std::cout << handle.pid << std::endl;
+    return 0;
+}
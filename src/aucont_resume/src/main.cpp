@@ -0,0 +1,39 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+#include <cctype>
+
+#include <aucont_common.h>
+#include <aucont_runtime.h>
+
+namespace
+{
+    void print_usage() {
+        std::cout << "USAGE: ./aucont_resume PID[,PID...]" << std::endl;
+        std::cout << "       Thaws containers paused with aucont_pause" << std::endl;
+    }
+}
+
+int AUCONT_TOOL_MAIN(resume)(int argc, char* argv[]) {
+    if (argc != 2) {
+        print_usage();
+        exit(1);
+    }
+    aucont::Runtime runtime(aucont::get_exe_dir());
+
+    std::stringstream ss(argv[1]);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty() || !std::all_of(item.begin(), item.end(), [](char c){ return std::isdigit(c); })) {
+            print_usage();
+            exit(1);
+        }
+        auto status = runtime.resume(std::stoi(item));
+        if (!status.ok()) {
+            aucont::error(status.msg);
+        }
+    }
+    return 0;
+}
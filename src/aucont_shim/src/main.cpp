@@ -0,0 +1,29 @@
+/**
+ * Waits for container init, which is a child of calling process (inherited
+ * through exec), to exit. Only libc is used to keep the shim small.
+ */
+
+#include <cstdlib>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        const char usage[] = "USAGE: aucont_shim PID\n";
+        if (write(STDERR_FILENO, usage, sizeof(usage) - 1) < 0) {
+            return 1;
+        }
+        return 1;
+    }
+    pid_t pid = std::atoi(argv[1]);
+    while (waitpid(pid, NULL, 0) < 0) {
+        if (errno != EINTR) {
+            return 1;
+        }
+    }
+    return 0;
+}
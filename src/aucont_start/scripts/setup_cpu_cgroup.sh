@@ -5,7 +5,8 @@ if [ "$#" -ne 4 ]; then
 fi
 
 CPU_PERC=$1
-CONT_PID=$2
+# container init pid; restored container has all its processes listed
+CONT_PIDS=$2
 CGROUP_HIERARCHY_DIR=$3
 CGROUP_NAME=$4
 CPU_CGROUP_DIR=${CGROUP_HIERARCHY_DIR}/${CGROUP_NAME}
@@ -37,8 +38,13 @@ GID=$(id -g)
 sudo mkdir -p "$CPU_CGROUP_DIR" && \
 sudo chown -R $UID:$GID "$CPU_CGROUP_DIR" && \
 echo $MAX_PERIOD > ${CPU_CGROUP_DIR}/cpu.cfs_period_us && \
-echo $(($PROC_NUM * $CPU_PERC * $MAX_PERIOD / 100)) > ${CPU_CGROUP_DIR}/cpu.cfs_quota_us && \
-echo $CONT_PID >> ${CPU_CGROUP_DIR}/tasks
-
+echo $(($PROC_NUM * $CPU_PERC * $MAX_PERIOD / 100)) > ${CPU_CGROUP_DIR}/cpu.cfs_quota_us
+if [ "$?" -ne "0" ]; then
+    exit 3
+fi
+# cgroup.procs moves all threads of process
+for PID in $CONT_PIDS; do
+    echo $PID >> ${CPU_CGROUP_DIR}/cgroup.procs || exit 4
+done
 
-exit $?
\ No newline at end of file
+exit 0
\ No newline at end of file
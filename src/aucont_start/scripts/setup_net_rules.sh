@@ -0,0 +1,14 @@
+#! /bin/bash
+
+# Publishes container ports on host and sets priority of container traffic
+# with aucont_portmap helper, which keeps nftables rules (and host ports)
+# until container exits
+# usage: setup_net_rules.sh CONT_PID HOST_VETH CONT_IP PRIO [HOST_PORT:CONT_PORT[/udp]...]
+
+if [ "$#" -lt 4 ]; then
+    exit 1
+fi
+
+sudo "$(dirname "$0")/aucont_portmap" "$@"
+
+exit $?
@@ -0,0 +1,34 @@
+#! /bin/bash
+
+# Shapes container traffic on its veth pair:
+#   RATE  - bits per second; traffic to container is shaped by tbf on host
+#           end, traffic from container by tbf on container end (set from
+#           host, container itself doesn't need tc)
+#   BURST - bytes, which may be sent at once above RATE
+# Packets queued by host end tbf are served by pfifo_fast bands, so traffic of
+# `--net-prio interactive` containers overtakes bulk one; queue is kept at
+# about 50 ms of traffic (at least 16 packets), as bands only matter for
+# packets that are already queued
+
+if [ "$#" -ne 5 ]; then
+    exit 1
+fi
+
+CONT_PID=$1
+HOST_VETH=$2
+CONT_VETH=$3
+RATE=$4
+BURST=$5
+
+QUEUE_LEN=$(( RATE / 8 / 20 / 1500 ))
+if [ "${QUEUE_LEN}" -lt 16 ]; then
+    QUEUE_LEN=16
+fi
+
+sudo ip link set dev "${HOST_VETH}" txqueuelen "${QUEUE_LEN}" && \
+sudo tc qdisc add dev "${HOST_VETH}" root handle 1: tbf rate "${RATE}bit" burst "${BURST}" latency 50ms && \
+sudo tc qdisc add dev "${HOST_VETH}" parent 1:1 pfifo_fast && \
+sudo nsenter -t "${CONT_PID}" -n \
+    tc qdisc add dev "${CONT_VETH}" root tbf rate "${RATE}bit" burst "${BURST}" latency 50ms
+
+exit $?
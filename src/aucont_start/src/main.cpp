@@ -1,45 +1,174 @@
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
 #include <string>
 #include <ostream>
 #include <algorithm>
+#include <utility>
 
+#include <cstdint>
 #include <cstring>
 #include <cctype>
 #include <cstdlib>
+#include <cerrno>
 
+#include <unistd.h>
 #include <arpa/inet.h>
 
 #include <aucont_common.h>
-
-#include "aucontainer.h"
+#include <aucont_runtime.h>
+#include <aucont_prewarm.h>
+#include <aucont_ready.h>
 
 namespace 
 {
     void print_usage()
     {
-        std::cout << "USAGE: ./aucont_start [-d --cpu CPU_PERC --net IP] IMAGE_PATH CMD [ARGS]" << std::endl;
+        std::cout << "USAGE: ./aucont_start [-d --init --exec-agent --log --log-size KB --cpu CPU_PERC --cpu-range MIN:MAX --mem-range MIN:MAX --pressure-events --net IP --net-rate RATE "
+                  << "--net-burst SIZE --net-prio PRIO -p HOST_PORT:CONT_PORT[/udp] --ready-probe PROBE --wait-ready[=SEC] --prewarm LIST "
+                  << "--prewarm-record LIST --rootfs-mode MODE] "
+                  << "IMAGE_PATH CMD [ARGS]" << std::endl;
         std::cout << "       IMAGE_PATH - path to image of container file system" << std::endl;
         std::cout << "       CMD - command to run inside container" << std::endl;
         std::cout << "       ARGS - arguments for CMD" << std::endl;
         std::cout << "       -d - daemonize" << std::endl;
+        std::cout << "       --init - run CMD under minimal init, which reaps zombies, forwards signals to CMD"
+        << " and exits with its status" << std::endl;
+        std::cout << "       --exec-agent - run exec agent for `aucont_exec --fast` in container init (implies --init)"
+        << std::endl;
+        std::cout << "       --log - capture output of daemonized container (see aucont_logs)" << std::endl;
+        std::cout << "       --log-size KB - max size of one log part (two last parts are kept), 1024 by default"
+        << std::endl;
         std::cout << "       --cpu CPU_PERC - percent of cpu resources allocated for container 1..100" << std::endl;
+        std::cout << "       --cpu-range MIN:MAX - let aucont_autoscale adapt cpu limit to load within MIN..MAX percents"
+        << " (--cpu is initial limit then, MAX by default)" << std::endl;
+        std::cout << "       --mem-range MIN:MAX - let aucont_autoscale adapt memory.high within MIN..MAX bytes"
+        << " (k, m and g suffixes may be used), it's MAX initially" << std::endl;
+        std::cout << "       --pressure-events - give container its own cgroup v2, so aucont_events reports its cpu"
+        << " stalls and memory events (containers with --cpu-range or --mem-range have it anyway)" << std::endl;
         std::cout << "       --net IP - create virtual network between host and container with container IP address" 
         << std::endl;
+        std::cout << "       --net-rate RATE - limit container traffic (each direction) to RATE bits per second,"
+        << " k, m and g suffixes may be used (e.g. 10m)" << std::endl;
+        std::cout << "       --net-burst SIZE - bytes, which may be sent at once above rate (k and m suffixes may be"
+        << " used), chosen by rate by default" << std::endl;
+        std::cout << "       --net-prio PRIO - `interactive`, `normal` (default) or `bulk`: priority of container's"
+        << " outgoing traffic on host" << std::endl;
+        std::cout << "       -p HOST_PORT:CONT_PORT[/udp] - forward HOST_PORT of host to CONT_PORT of container"
+        << " (requires --net, may be repeated)" << std::endl;
+        std::cout << "       --ready-probe PROBE - how workload reports readiness: `notify` (default; it writes READY=1"
+        << " into fd from AUCONT_READY_FD env variable), `tcp:PORT` (PORT of container accepts connections, requires"
+        << " --net) or `file:/PATH` (PATH exists in container)" << std::endl;
+        std::cout << "       --wait-ready[=SEC] - print pid and return only when workload is ready, at most SEC seconds"
+        << " (30 by default); result is recorded in registry, not ready container is left running and its pid"
+        << " is printed too, but exit code is non-zero" << std::endl;
+        std::cout << "       --prewarm LIST - read image files listed in LIST (one path per line, relative to image root)"
+        << " into page cache in parallel with container setup" << std::endl;
+        std::cout << "       --prewarm-record LIST - write image files mapped by container during run into LIST,"
+        << " to use it later with --prewarm (not allowed with -d)" << std::endl;
+        std::cout << "       --rootfs-mode MODE - `bind` (default) to use image in place or `tmpfs` to copy it into memory"
+        << std::endl;
+    }
+
+    const int prewarm_record_interval_ms = 20;
+    const int default_ready_timeout_sec = 30;
+
+    /**
+     * parses positive number with optional suffix: k, m or g multiply it by `unit`, `unit`^2 or `unit`^3
+     */
+    uint64_t parse_units(const char* str, uint64_t unit, const char* what)
+    {
+        const std::string suffixes = "kmg";
+        const std::runtime_error bad_value(std::string(what) + " must be a positive number with optional k, m or g suffix");
+        const char* suffix = str;
+        while (std::isdigit(*suffix)) {
+            ++suffix;
+        }
+        uint64_t value = std::strtoull(str, nullptr, 10);
+        if (suffix == str || value == 0) {
+            throw bad_value;
+        }
+        if (*suffix != '\0') {
+            auto power = suffixes.find(std::tolower(*suffix));
+            if (power == std::string::npos || suffix[1] != '\0') {
+                throw bad_value;
+            }
+            for (size_t i = 0; i <= power; ++i) {
+                value *= unit;
+            }
+        }
+        return value;
     }
 
-    aucont::options parse_options(int argc, const char** argv)
+    /**
+     * splits MIN:MAX range into its bounds
+     */
+    std::pair<std::string, std::string> parse_range(const std::string& str, const char* what)
+    {
+        auto colon = str.find(':');
+        if (colon == std::string::npos) {
+            throw std::runtime_error(std::string(what) + " range must be MIN:MAX");
+        }
+        return { str.substr(0, colon), str.substr(colon + 1) };
+    }
+
+    aucont::port_mapping parse_port_mapping(const std::string& str)
+    {
+        const std::runtime_error bad_value("Port mapping must be HOST_PORT:CONT_PORT[/udp] with ports in [1, 65535]");
+        auto colon = str.find(':');
+        auto slash = str.find('/');
+        std::string host_port = str.substr(0, colon);
+        std::string cont_port = colon == std::string::npos ? "" : str.substr(colon + 1, slash - colon - 1);
+        std::string proto = slash == std::string::npos ? "tcp" : str.substr(slash + 1);
+        for (const auto& port : { host_port, cont_port }) {
+            if (port.empty() || port.length() > 5 ||
+                std::any_of(port.begin(), port.end(), [](char c){ return !std::isdigit(c); }) ||
+                std::stoi(port) < 1 || std::stoi(port) > 65535) {
+                throw bad_value;
+            }
+        }
+        if (proto != "tcp" && proto != "udp") {
+            throw bad_value;
+        }
+        return aucont::port_mapping(std::stoi(host_port), std::stoi(cont_port), proto == "udp");
+    }
+
+    /**
+     * @param ready_timeout_sec set to timeout of readiness waiting, stays < 0 if readiness isn't awaited
+     */
+    aucont::options parse_options(int argc, char** argv, std::string& prewarm_record, int& ready_timeout_sec)
     {
         aucont::options opts;
         for (int i = 1; i < argc; ++i) {
-            if ((!std::strcmp(argv[i], "--cpu") || !std::strcmp(argv[i], "--net")) && i + 1 >= argc) {
+            if ((!std::strcmp(argv[i], "--cpu") || !std::strcmp(argv[i], "--net") ||
+                 !std::strcmp(argv[i], "--prewarm") || !std::strcmp(argv[i], "--prewarm-record") ||
+                 !std::strcmp(argv[i], "--rootfs-mode") || !std::strcmp(argv[i], "--log-size") ||
+                 !std::strcmp(argv[i], "--net-rate") || !std::strcmp(argv[i], "--net-burst") ||
+                 !std::strcmp(argv[i], "--net-prio") || !std::strcmp(argv[i], "-p") ||
+                 !std::strcmp(argv[i], "--cpu-range") || !std::strcmp(argv[i], "--mem-range") ||
+                 !std::strcmp(argv[i], "--ready-probe")) && i + 1 >= argc) {
                 aucont::error("No arguments specified for some options");
             }
 
             if (!std::strcmp(argv[i], "-d")) {
                 opts.daemonize = true;
+            } else if (!std::strcmp(argv[i], "--log")) {
+                opts.log = true;
+            } else if (!std::strcmp(argv[i], "--init")) {
+                opts.init = true;
+            } else if (!std::strcmp(argv[i], "--exec-agent")) {
+                opts.init = true;
+                opts.exec_agent = true;
+            } else if (!std::strcmp(argv[i], "--pressure-events")) {
+                opts.pressure_events = true;
+            } else if (!std::strcmp(argv[i], "--log-size")) {
+                if (std::any_of(argv[i + 1], argv[i + 1] + strlen(argv[i + 1]),
+                    [](char c){ return !std::isdigit(c); }) || std::atol(argv[i + 1]) < 1) {
+                    throw std::runtime_error("Log size must be a positive number of kilobytes");
+                }
+                opts.log_size = std::atol(argv[++i]) * 1024;
             } else if (!std::strcmp(argv[i], "--cpu")) {
                 if (std::any_of(argv[i + 1], argv[i + 1] + strlen(argv[i + 1]), 
                     [](char c){ return !std::isdigit(c); })) { // check if is number
@@ -50,20 +179,67 @@ namespace
                         throw std::runtime_error("Percent of cpu usage must be in [1, 100]");
                     }
                 }
+            } else if (!std::strcmp(argv[i], "--cpu-range")) {
+                auto range = parse_range(argv[++i], "Cpu");
+                for (const auto& bound : { range.first, range.second }) {
+                    if (bound.empty() || bound.length() > 3 ||
+                        std::any_of(bound.begin(), bound.end(), [](char c){ return !std::isdigit(c); })) {
+                        throw std::runtime_error("Cpu range bounds must be numbers in [1, 100]");
+                    }
+                }
+                opts.cpu_min = std::stoi(range.first);
+                opts.cpu_max = std::stoi(range.second);
+                if (opts.cpu_min < 1 || opts.cpu_min > opts.cpu_max || opts.cpu_max > 100) {
+                    throw std::runtime_error("Cpu range must be MIN:MAX with 1 <= MIN <= MAX <= 100");
+                }
+            } else if (!std::strcmp(argv[i], "--mem-range")) {
+                auto range = parse_range(argv[++i], "Memory");
+                opts.mem_min = parse_units(range.first.c_str(), 1024, "Memory range bound");
+                opts.mem_max = parse_units(range.second.c_str(), 1024, "Memory range bound");
+                if (opts.mem_min > opts.mem_max) {
+                    throw std::runtime_error("Memory range must be MIN:MAX with MIN <= MAX");
+                }
             } else if (!std::strcmp(argv[i], "--net")) {
                 struct in_addr taddr;
                 if (!inet_aton(argv[++i], &taddr)) {
                     throw std::runtime_error("Incorrect ip-address specified (see `man 3 inet_aton`)");
                 }
                 opts.ip = inet_ntoa(taddr);
+            } else if (!std::strcmp(argv[i], "--net-rate")) {
+                opts.net_rate = parse_units(argv[++i], 1000, "Network rate");
+            } else if (!std::strcmp(argv[i], "--net-burst")) {
+                opts.net_burst = parse_units(argv[++i], 1024, "Network burst");
+            } else if (!std::strcmp(argv[i], "--net-prio")) {
+                opts.net_prio = argv[++i];
+                if (opts.net_prio != "interactive" && opts.net_prio != "normal" && opts.net_prio != "bulk") {
+                    throw std::runtime_error("Network priority must be `interactive`, `normal` or `bulk`");
+                }
+            } else if (!std::strcmp(argv[i], "-p")) {
+                opts.ports.push_back(parse_port_mapping(argv[++i]));
+            } else if (!std::strcmp(argv[i], "--ready-probe")) {
+                opts.ready_probe = argv[++i];
+            } else if (!std::strcmp(argv[i], "--wait-ready")) {
+                ready_timeout_sec = default_ready_timeout_sec;
+            } else if (!std::strncmp(argv[i], "--wait-ready=", 13)) {
+                const char* timeout = argv[i] + 13;
+                if (*timeout == '\0' || std::any_of(timeout, timeout + strlen(timeout),
+                    [](char c){ return !std::isdigit(c); }) || std::atoi(timeout) < 1) {
+                    throw std::runtime_error("Readiness timeout must be a positive number of seconds");
+                }
+                ready_timeout_sec = std::atoi(timeout);
+            } else if (!std::strcmp(argv[i], "--prewarm")) {
+                opts.prewarm_list = argv[++i];
+            } else if (!std::strcmp(argv[i], "--prewarm-record")) {
+                prewarm_record = argv[++i];
+            } else if (!std::strcmp(argv[i], "--rootfs-mode")) {
+                std::string mode = argv[++i];
+                if (mode != "bind" && mode != "tmpfs") {
+                    throw std::runtime_error("Root filesystem mode must be `bind` or `tmpfs`");
+                }
+                opts.rootfs_tmpfs = mode == "tmpfs";
             } else {
                 opts.fsimg_path = aucont::get_real_path(argv[i++]);
-                opts.cmd = argv[i++];
-                opts.args[0] = opts.cmd;
-                for (int j = 0; j < argc - i; ++j) {
-                    opts.args[j + 1] = argv[j + i];
-                }
-                opts.args[argc - i + 1] = nullptr;
+                opts.args.assign(argv + i, argv + argc);
                 break;
             }
         }
@@ -72,28 +248,91 @@ namespace
         if (opts.fsimg_path.empty()) {
             throw std::runtime_error("No image path specified");
         }
-        if (opts.cmd == nullptr) {
+        if (opts.args.empty()) {
             throw std::runtime_error("No command specified to run inside container");
         }
+        if (opts.log && !opts.daemonize) {
+            throw std::runtime_error("Output can be logged only for daemonized container");
+        }
+        if ((opts.net_rate > 0 || opts.net_burst > 0 || opts.net_prio != "normal") && opts.ip.empty()) {
+            throw std::runtime_error("Network shaping options require --net");
+        }
+        if (!opts.ports.empty() && opts.ip.empty()) {
+            throw std::runtime_error("Ports can be published only with --net");
+        }
+        if (!opts.ready_probe.empty() || ready_timeout_sec >= 0) {
+            if (opts.ready_probe.empty()) {
+                opts.ready_probe = "notify";
+            }
+            if (ready_timeout_sec < 0) {
+                ready_timeout_sec = default_ready_timeout_sec;
+            }
+            aucont::check_ready_probe(opts);
+        }
+        if (opts.daemonize && !prewarm_record.empty()) {
+            throw std::runtime_error("Prewarm trace can't be recorded for daemonized container");
+        }
 
         return opts;
     }
 }
 
-int main(int argc, const char* argv[]) 
+int AUCONT_TOOL_MAIN(start)(int argc, char* argv[])
 {
     aucont::options opts;
+    std::string prewarm_record;
+    int ready_timeout_sec = -1;
     try {
-        opts = parse_options(argc, argv);
-    } catch (std::runtime_error err) {
+        opts = parse_options(argc, argv, prewarm_record, ready_timeout_sec);
+    } catch (const std::runtime_error& err) {
         std::cout << "Bad arguments: " << err.what() << std::endl;
         print_usage();
         return 0;
     }
 
-    auto exe_path = aucont::get_file_real_dir(argv[0]);
-    aucont::set_aucont_root(exe_path);
-    aucont::start_container(opts, exe_path);
+    aucont::Runtime runtime(aucont::get_exe_dir());
+    aucont::container_handle handle;
+    auto status = runtime.start(opts, handle);
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
+    if (ready_timeout_sec >= 0) {
+        status = runtime.wait_ready(handle, opts, ready_timeout_sec * 1000);
+        if (!status.ok()) {
+            // container is left running (or exited), pid lets caller inspect or stop it
+            std::cout << handle.pid << std::endl;
+            aucont::error(status.msg);
+        }
+    }
+    std::cout << handle.pid << std::endl;
+    if (opts.daemonize) {
+        return 0;
+    }
+
+    if (prewarm_record.empty()) {
+        // container init is our child; tiny static shim waits for it instead of us, so
+        // no full C++ runtime lingers per foreground container (registry drops dead ones)
+        std::cout.flush();
+        auto shim = runtime.root() + "/aucont_shim";
+        execl(shim.c_str(), "aucont_shim", std::to_string(handle.pid).c_str(), (char*) NULL);
+        status = runtime.wait(handle, -1);
+    } else {
+        std::set<std::string> trace;
+        do {
+            aucont::record_mapped_files(handle.pid, opts.fsimg_path, trace);
+            status = runtime.wait(handle, prewarm_record_interval_ms);
+        } while (status.code == ETIMEDOUT);
+        if (status.ok()) {
+            try {
+                aucont::write_prewarm_list(prewarm_record, trace);
+            } catch (const std::runtime_error& err) {
+                aucont::error(err.what());
+            }
+        }
+    }
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
 
     return 0;
 }
@@ -1,43 +1,91 @@
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <stdexcept>
+#include <vector>
+#include <algorithm>
 
 #include <csignal>
 #include <cstring>
-#include <cerrno>
+#include <cctype>
 
 #include <sys/types.h>
 
 #include <aucont_common.h>
+#include <aucont_runtime.h>
 
 namespace
 {
     void print_usage() {
-        std::cout << "USAGE: ./aucont_stop PID [SIGNUM]" << std::endl;
+        std::cout << "USAGE: ./aucont_stop [--timeout SEC] (--all | PID[,PID...]) [SIGNUM]" << std::endl;
+        std::cout << "       SIGNUM - signal to send, SIGTERM by default" << std::endl;
+        std::cout << "       --all - stop every running container" << std::endl;
+        std::cout << "       --timeout SEC - wait for containers to exit, containers still running after SEC "
+                  << "seconds are killed with SIGKILL; without it signal is sent and tool returns immediately"
+                  << std::endl;
     }
-}
 
-int main(int argc, char* argv[]) {
-    aucont::set_aucont_root(aucont::get_file_real_dir(argv[0]));
+    bool is_number(const std::string& str)
+    {
+        return !str.empty() && std::all_of(str.begin(), str.end(), [](char c){ return std::isdigit(c); });
+    }
+}
 
-    if (argc < 2 || argc > 3) {
+int AUCONT_TOOL_MAIN(stop)(int argc, char* argv[]) {
+    int timeout_ms = -1;
+    int i = 1;
+    if (i + 1 < argc && !std::strcmp(argv[i], "--timeout")) {
+        if (!is_number(argv[i + 1])) {
+            print_usage();
+            exit(1);
+        }
+        timeout_ms = std::atoi(argv[i + 1]) * 1000;
+        i += 2;
+    }
+    if (argc - i < 1 || argc - i > 2) {
         print_usage();
         exit(1);
     }
-
-    pid_t pid = atoi(argv[1]);
+    std::string targets_arg = argv[i];
     int signum = SIGTERM;
-    if (argc == 3) {
-        signum = atoi(argv[2]);
+    if (argc - i == 2) {
+        signum = atoi(argv[i + 1]);
     }
 
-    if (aucont::get_container(pid).pid == -1) {
-        std::cout << "No container with pid [ " + std::to_string(pid) + " ] ==> nothing to kill" << std::endl;
+    aucont::Runtime runtime(aucont::get_exe_dir());
+    std::vector<aucont::container_t> conts;
+    auto status = runtime.list(conts);
+    if (!status.ok()) {
+        aucont::error(status.msg);
     }
-    if (kill(pid, signum) < 0 && errno != ESRCH) {
-        aucont::stdlib_error("Can't send signal");
+    std::vector<pid_t> pids;
+    if (targets_arg == "--all") {
+        for (const auto& cont : conts) {
+            pids.push_back(cont.pid);
+        }
+    } else {
+        std::stringstream ss(targets_arg);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!is_number(item)) {
+                print_usage();
+                exit(1);
+            }
+            pid_t pid = std::stoi(item);
+            if (std::find(conts.begin(), conts.end(), aucont::container_t(pid)) == conts.end()) {
+                std::cout << "No container with pid [ " + std::to_string(pid) + " ] ==> nothing to kill" << std::endl;
+                continue;
+            }
+            pids.push_back(pid);
+        }
     }
 
+    std::vector<pid_t> killed;
+    status = runtime.stop(pids, signum, timeout_ms, &killed);
+    for (auto pid : killed) {
+        std::cout << "Container [ " << pid << " ] didn't stop in time ==> killed" << std::endl;
+    }
+    if (!status.ok()) {
+        aucont::error(status.msg);
+    }
     return 0;
 }
@@ -0,0 +1,133 @@
+#include "aucont_agent.h"
+#include "aucont_common.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        // must match aucont_pid1
+        const size_t max_request_size = 64 * 1024;
+        const int agent_backlog = 64;
+
+        struct sockaddr_un make_address(const string& path)
+        {
+            struct sockaddr_un addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.length() >= sizeof(addr.sun_path)) {
+                throw_error("Exec agent socket path is too long [ " + path + " ]", ENAMETOOLONG);
+            }
+            std::strcpy(addr.sun_path, path.c_str());
+            return addr;
+        }
+    }
+
+    string get_agent_sock_path(const string& root_dir, pid_t cont_pid)
+    {
+        return root_dir + "/agents/" + std::to_string(cont_pid) + ".sock";
+    }
+
+    void listen_agent_socket(int sock_fd, const string& root_dir, pid_t cont_pid)
+    {
+        // only owner of aucont root may run commands through agents
+        const string agents_dir = root_dir + "/agents";
+        if (mkdir(agents_dir.c_str(), 0700) != 0 && errno != EEXIST) {
+            throw_stdlib_error("Can't create directory [ " + agents_dir + " ]");
+        }
+        const string path = get_agent_sock_path(root_dir, cont_pid);
+        auto addr = make_address(path);
+        unlink(path.c_str()); // left by exited container with same pid
+        if (bind(sock_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            throw_stdlib_error("Can't bind exec agent socket [ " + path + " ]");
+        }
+        if (listen(sock_fd, agent_backlog) < 0) {
+            throw_stdlib_error("Can't listen on exec agent socket");
+        }
+    }
+
+    int agent_exec(const string& root_dir, pid_t cont_pid,
+                   const std::vector<string>& args, const exec_options& exec_opts)
+    {
+        if (args.empty()) {
+            throw_error("No command specified to run inside container");
+        }
+        string request;
+        for (const auto& arg : args) {
+            request += arg;
+            request += '\0';
+        }
+        if (request.size() > max_request_size) {
+            throw_error("Command is too long for exec agent", E2BIG);
+        }
+        auto addr = make_address(get_agent_sock_path(root_dir, cont_pid));
+
+        int conn_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (conn_fd < 0) {
+            throw_stdlib_error("Can't create exec agent connection");
+        }
+        if (connect(conn_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            int err = errno;
+            close(conn_fd);
+            if (err == ENOENT || err == ECONNREFUSED) {
+                throw_error("Container " + std::to_string(cont_pid) + " has no exec agent", ECONNREFUSED);
+            }
+            errno = err;
+            throw_stdlib_error("Can't connect to exec agent of container " + std::to_string(cont_pid));
+        }
+
+        int fds[3] = {
+            exec_opts.stdin_fd >= 0 ? exec_opts.stdin_fd : STDIN_FILENO,
+            exec_opts.stdout_fd >= 0 ? exec_opts.stdout_fd : STDOUT_FILENO,
+            exec_opts.stderr_fd >= 0 ? exec_opts.stderr_fd : STDERR_FILENO,
+        };
+        union {
+            char buf[CMSG_SPACE(sizeof(fds))];
+            struct cmsghdr align;
+        } control;
+        std::memset(&control, 0, sizeof(control));
+        struct iovec iov = { &request[0], request.size() };
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        if (sendmsg(conn_fd, &msg, MSG_NOSIGNAL) < 0) {
+            int err = errno;
+            close(conn_fd);
+            errno = err;
+            throw_stdlib_error("Can't send command to exec agent");
+        }
+        return conn_fd;
+    }
+
+    int read_agent_exit_code(int conn_fd)
+    {
+        int32_t code = 0;
+        ssize_t len = 0;
+        do {
+            len = recv(conn_fd, &code, sizeof(code), 0);
+        } while (len < 0 && errno == EINTR);
+        if (len < 0) {
+            throw_stdlib_error("Can't read exit code from exec agent");
+        } else if (len != sizeof(code)) {
+            throw_error("Exec agent didn't report exit code: container exited or command can't be started", ECHILD);
+        }
+        return code;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "aucont_runtime.h"
+
+namespace aucont
+{
+    /**
+     * Exec agent runs commands in container without setns: init of container
+     * started with `exec_agent` option (aucont_pid1) listens on SOCK_SEQPACKET
+     * socket `root_dir/agents/<pid>.sock`, which is bound on host and inherited
+     * by init (its fd number is passed in AUCONT_AGENT_FD environment variable).
+     * Protocol, one connection per command:
+     *   request  - NUL terminated command and arguments in one message, with
+     *              caller's stdin, stdout and stderr attached (SCM_RIGHTS);
+     *              command writes straight into them, no output is relayed
+     *   response - int32 exit code (128 + signal for killed command), sent when
+     *              command is reaped; connection is closed without it if
+     *              command can't be started
+     * Command runs in its own process group, which is killed with SIGKILL if
+     * caller closes connection before command exits.
+     */
+    const char agent_fd_env[] = "AUCONT_AGENT_FD";
+
+    /**
+     * returns path of exec agent socket of container
+     */
+    std::string get_agent_sock_path(const std::string& root_dir, pid_t cont_pid);
+
+    /**
+     * Binds exec agent socket, created before container init was forked, to its
+     * path and starts listening. Throws aucont_error on failure
+     */
+    void listen_agent_socket(int sock_fd, const std::string& root_dir, pid_t cont_pid);
+
+    /**
+     * Sends command to exec agent of container. Throws aucont_error on failure
+     * (ECONNREFUSED if container has no exec agent)
+     * @return connection, exit code of command is read from it with `read_agent_exit_code`
+     */
+    int agent_exec(const std::string& root_dir, pid_t cont_pid,
+                   const std::vector<std::string>& args, const exec_options& exec_opts);
+
+    /**
+     * reads exit code of command from agent connection; throws aucont_error if
+     * agent closed connection without it
+     */
+    int read_agent_exit_code(int conn_fd);
+}
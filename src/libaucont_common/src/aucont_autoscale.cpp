@@ -0,0 +1,225 @@
+#include "aucont_autoscale.h"
+#include "aucont_cgroup.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace aucont
+{
+    using std::string;
+    using std::vector;
+
+    namespace
+    {
+        // share of interval, which container is stalled or throttled for, to raise its limit
+        const double raise_pressure = 0.1;
+        // and max share to lower its limit
+        const double lower_pressure = 0.02;
+        // intervals after raise, during which limit isn't lowered
+        const int hold_intervals = 5;
+        // smallest change of cpu limit, percent of host cpu time
+        const uint64_t min_cpu_step = 2;
+
+        uint64_t host_cpus()
+        {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            return cpus > 0 ? cpus : 1;
+        }
+
+        uint64_t host_memory()
+        {
+            return static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+        }
+
+        /**
+         * growth of counter, counters of recreated cgroup start from 0
+         */
+        uint64_t delta(uint64_t now, uint64_t last)
+        {
+            return now > last ? now - last : 0;
+        }
+
+        string percent(double share)
+        {
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(0) << share * 100 << "%";
+            return ss.str();
+        }
+    }
+
+    limit_controller::limit_controller(const string& root_dir, const autoscale_options& opts)
+    : root_dir(root_dir), opts(opts), reg(root_dir)
+    {
+        if (this->opts.mem_budget == 0) {
+            this->opts.mem_budget = host_memory();
+        }
+    }
+
+    limit_controller::sample limit_controller::read_sample(const container_t& cont) const
+    {
+        const string cg_dir = get_cont_cgroup2_dir(root_dir, cont.pid);
+        auto cpu_stat = read_cgroup_stat(cg_dir + "/cpu.stat");
+        sample result;
+        result.time_ms = monotonic_ms();
+        result.cpu_usage_us = cpu_stat["usage_usec"];
+        if (cpu_stat.count("throttled_usec") != 0) {
+            result.cpu_throttled_us = cpu_stat["throttled_usec"];
+        } else {
+            // cpu controller is in v1 hierarchy, where time is in nanoseconds
+            auto v1_stat = read_cgroup_stat(get_cpu_cgroup_path(root_dir) + "/" + get_cont_cpu_cgroup(cont) + "/cpu.stat");
+            result.cpu_throttled_us = v1_stat["throttled_time"] / 1000;
+        }
+        result.cpu_stall_us = read_pressure_stall_us(cg_dir + "/cpu.pressure");
+        result.mem_stall_us = read_pressure_stall_us(cg_dir + "/memory.pressure");
+        return result;
+    }
+
+    void limit_controller::step(vector<limit_decision>& decisions)
+    {
+        vector<limit_state> cpu_limits;
+        vector<limit_state> mem_limits;
+        std::map<pid_t, container_t> managed;
+        for (const auto& cont : reg.get_containers()) {
+            if (cont.cpu_max == 0 && cont.mem_max == 0) {
+                continue;
+            }
+            managed[cont.pid] = cont;
+            auto now = read_sample(cont);
+            auto it = states.find(cont.pid);
+            if (it == states.end()) {
+                // first interval of container starts now, its limits only take budget
+                it = states.insert({ cont.pid, { now, 0, 0 } }).first;
+            }
+            auto& state = it->second;
+            revise_cpu(cont, state.last, now, state, cpu_limits);
+            revise_memory(cont, state.last, now, state, mem_limits);
+            state.last = now;
+        }
+        for (auto it = states.begin(); it != states.end();) {
+            it = managed.count(it->first) == 0 ? states.erase(it) : std::next(it);
+        }
+
+        fit_budget(cpu_limits, opts.cpu_budget);
+        fit_budget(mem_limits, opts.mem_budget);
+        for (const auto& cpu : cpu_limits) {
+            if (cpu.wanted == cpu.limit ||
+                !set_cont_cpu_limit(root_dir, managed[cpu.pid], static_cast<int>(cpu.wanted))) {
+                continue;
+            }
+            if (cpu.wanted > cpu.limit) {
+                states[cpu.pid].cpu_hold = hold_intervals;
+            }
+            decisions.push_back({ cpu.pid, "cpu", cpu.limit, cpu.wanted, cpu.reason });
+        }
+        for (const auto& mem : mem_limits) {
+            if (mem.wanted == mem.limit || !set_cont_memory_high(root_dir, mem.pid, mem.wanted)) {
+                continue;
+            }
+            if (mem.wanted > mem.limit) {
+                states[mem.pid].mem_hold = hold_intervals;
+            }
+            decisions.push_back({ mem.pid, "memory", mem.limit, mem.wanted, mem.reason });
+        }
+    }
+
+    void limit_controller::revise_cpu(const container_t& cont, const sample& last, const sample& now,
+                                      container_state& state, vector<limit_state>& limits)
+    {
+        if (cont.cpu_max == 0) {
+            return;
+        }
+        int limit = get_cont_cpu_limit(root_dir, cont);
+        if (limit < 0) {
+            return;
+        }
+        limit_state cpu = { cont.pid, static_cast<uint64_t>(limit), cont.cpu_min, cont.cpu_max,
+                            static_cast<uint64_t>(limit), "" };
+        double interval_us = (now.time_ms - last.time_ms) * 1000.0;
+        if (state.cpu_hold > 0) {
+            --state.cpu_hold;
+        }
+        // frozen container uses no cpu, but doesn't need less of it
+        if (!cont.paused && interval_us > 0) {
+            double usage = delta(now.cpu_usage_us, last.cpu_usage_us) * 100.0 / (interval_us * host_cpus());
+            double throttled = delta(now.cpu_throttled_us, last.cpu_throttled_us) / interval_us;
+            double stall = delta(now.cpu_stall_us, last.cpu_stall_us) / interval_us;
+            cpu.reason = "stall " + percent(stall) + ", throttled " + percent(throttled) +
+                         ", usage " + percent(usage / 100);
+            if (std::max(throttled, stall) > raise_pressure) {
+                cpu.wanted = std::min(cpu.max_limit, cpu.limit + std::max(cpu.limit / 2, min_cpu_step));
+            } else if (std::max(throttled, stall) < lower_pressure && usage < cpu.limit / 2.0 && state.cpu_hold == 0) {
+                auto target = std::max(cpu.min_limit, static_cast<uint64_t>(usage * 1.5) + 1);
+                auto lowered = cpu.limit - (cpu.limit - std::min(target, cpu.limit)) / 2;
+                if (cpu.limit - lowered >= min_cpu_step) {
+                    cpu.wanted = lowered;
+                }
+            }
+            // limit may be out of bounds only if it was changed by somebody else
+            cpu.wanted = std::min(std::max(cpu.wanted, cpu.min_limit), cpu.max_limit);
+        }
+        limits.push_back(cpu);
+    }
+
+    void limit_controller::revise_memory(const container_t& cont, const sample& last, const sample& now,
+                                         container_state& state, vector<limit_state>& limits)
+    {
+        if (cont.mem_max == 0) {
+            return;
+        }
+        uint64_t limit = get_cont_memory_high(root_dir, cont.pid);
+        if (limit == 0) {
+            return;
+        }
+        limit = std::min(limit, cont.mem_max);
+        limit_state mem = { cont.pid, limit, cont.mem_min, cont.mem_max, limit, "" };
+        double interval_us = (now.time_ms - last.time_ms) * 1000.0;
+        if (state.mem_hold > 0) {
+            --state.mem_hold;
+        }
+        if (!cont.paused && interval_us > 0) {
+            uint64_t current = 0;
+            std::ifstream(get_cont_cgroup2_dir(root_dir, cont.pid) + "/memory.current") >> current;
+            double stall = delta(now.mem_stall_us, last.mem_stall_us) / interval_us;
+            mem.reason = "stall " + percent(stall) + ", used " + percent(static_cast<double>(current) / limit);
+            if (stall > raise_pressure) {
+                mem.wanted = std::min(mem.max_limit, mem.limit + mem.limit / 4);
+            } else if (stall < lower_pressure && current < mem.limit / 2 && state.mem_hold == 0) {
+                auto target = std::max(mem.min_limit, current + current / 2);
+                auto lowered = mem.limit - (mem.limit - std::min(target, mem.limit)) / 2;
+                if (mem.limit - lowered >= mem.limit / 16) {
+                    mem.wanted = lowered;
+                }
+            }
+            mem.wanted = std::min(std::max(mem.wanted, mem.min_limit), mem.max_limit);
+        }
+        limits.push_back(mem);
+    }
+
+    void limit_controller::fit_budget(vector<limit_state>& limits, uint64_t budget)
+    {
+        // lowered limits free budget first
+        uint64_t used = 0;
+        uint64_t requested = 0;
+        for (const auto& state : limits) {
+            used += std::min(state.limit, state.wanted);
+            requested += delta(state.wanted, state.limit);
+        }
+        uint64_t free = delta(budget, used);
+        if (requested <= free) {
+            return;
+        }
+        for (auto& state : limits) {
+            if (state.wanted > state.limit) {
+                // double: memory sizes overflow in integer multiplication
+                auto granted = static_cast<uint64_t>(static_cast<double>(state.wanted - state.limit) * free / requested);
+                state.wanted = state.limit + granted;
+                state.reason += ", cut by budget";
+            }
+        }
+    }
+}
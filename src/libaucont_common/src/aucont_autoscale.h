@@ -0,0 +1,116 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include "aucont_common.h"
+#include "aucont_registry.h"
+
+namespace aucont
+{
+    /**
+     * Settings of adaptive limits controller
+     */
+    struct autoscale_options
+    {
+        int interval_ms;     // how often limits are revised
+        int cpu_budget;      // max sum of adaptive cpu limits, percent of host cpu time
+        uint64_t mem_budget; // max sum of adaptive memory limits in bytes, 0 - host memory size
+
+        autoscale_options(): interval_ms(1000), cpu_budget(100), mem_budget(0)
+        {}
+    };
+
+    /**
+     * Limit change made by controller
+     */
+    struct limit_decision
+    {
+        pid_t pid;
+        std::string resource; // `cpu` (percent of host cpu time) or `memory` (bytes)
+        uint64_t old_limit;
+        uint64_t new_limit;
+        std::string reason;   // measurements of last interval, which caused change
+    };
+
+    /**
+     * Adapts limits of containers, started with cpu or memory range, to their
+     * load. Every interval controller reads pressure (PSI `some` stall time of
+     * `cpu.pressure`/`memory.pressure`), cpu throttled time, cpu usage and memory
+     * use of container's cgroup and
+     *   - raises limit by half (memory by quarter) if container was stalled or
+     *     throttled for more than 10% of interval;
+     *   - lowers limit half way to 1.5 of used amount if container was almost
+     *     never stalled and used less than half of limit.
+     * Limits stay within container bounds; raises are granted only while sum
+     * of adaptive limits fits into budget (proportionally to requested raises,
+     * if all of them don't fit). Damping: limit is not lowered for 5 intervals
+     * after raise and changes less than 2 percent of host cpu (1/16 of memory
+     * limit) are not made, so limits don't oscillate.
+     * Throws aucont_error on failure
+     */
+    class limit_controller
+    {
+    public:
+        limit_controller(const std::string& root_dir, const autoscale_options& opts);
+
+        /**
+         * Revises limits of all running containers with adaptive limits once;
+         * made changes are appended to `decisions`
+         */
+        void step(std::vector<limit_decision>& decisions);
+
+    private:
+        /**
+         * Counters of container's cgroup at the end of last interval
+         */
+        struct sample
+        {
+            int64_t time_ms;
+            uint64_t cpu_usage_us;
+            uint64_t cpu_throttled_us;
+            uint64_t cpu_stall_us;
+            uint64_t mem_stall_us;
+        };
+
+        /**
+         * Limit of one resource with change requested for it
+         */
+        struct limit_state
+        {
+            pid_t pid;
+            uint64_t limit;
+            uint64_t min_limit;
+            uint64_t max_limit;
+            uint64_t wanted;
+            std::string reason;
+        };
+
+        struct container_state
+        {
+            sample last;
+            int cpu_hold; // intervals left, when cpu limit can't be lowered
+            int mem_hold;
+        };
+
+        sample read_sample(const container_t& cont) const;
+        void revise_cpu(const container_t& cont, const sample& last, const sample& now,
+                        container_state& state, std::vector<limit_state>& limits);
+        void revise_memory(const container_t& cont, const sample& last, const sample& now,
+                           container_state& state, std::vector<limit_state>& limits);
+        /**
+         * cuts raises, which don't fit into budget
+         */
+        static void fit_budget(std::vector<limit_state>& limits, uint64_t budget);
+
+        std::string root_dir;
+        autoscale_options opts;
+        registry reg;
+        std::map<pid_t, container_state> states;
+    };
+}
@@ -0,0 +1,161 @@
+#include "aucont_cgroup.h"
+#include "aucont_common.h"
+
+#include <fstream>
+
+#include <unistd.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        // period of cpu.max written by aucont (v1 cgroups keep period set on creation)
+        const uint64_t cpu_max_period_us = 100000;
+
+        uint64_t host_cpus()
+        {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            return cpus > 0 ? cpus : 1;
+        }
+
+        bool write_cgroup_file(const string& path, const string& value)
+        {
+            std::ofstream out(path);
+            out << value;
+            out.close();
+            return !out.fail();
+        }
+
+        /**
+         * reads first word of cgroup file, empty if there is no such file
+         */
+        string read_cgroup_file(const string& path)
+        {
+            std::ifstream in(path);
+            string value;
+            in >> value;
+            return value;
+        }
+    }
+
+    string get_cpu_cgroup_path(const string& root_dir)
+    {
+        return root_dir + "/cgrouph";
+    }
+
+    string get_cont_cpu_cgroup(const container_t& cont)
+    {
+        return cont.cpu_max > 0 ? "cont_" + std::to_string(cont.pid) : get_cgroup_for_cpuperc(cont.cpu_perc);
+    }
+
+    string get_cgroup2_path(const string& root_dir)
+    {
+        return root_dir + "/cgroup2h";
+    }
+
+    string get_cont_cgroup2_dir(const string& root_dir, pid_t pid)
+    {
+        // same name as v2 freezer cgroup, so both are one cgroup if freezer hierarchy is v2 too
+        return get_cgroup2_path(root_dir) + "/cont_" + std::to_string(pid);
+    }
+
+    bool setup_cont_cgroup2(const string& root_dir, pid_t pid, const std::set<pid_t>& procs)
+    {
+        const string script = root_dir + "/setup_cgroup2.sh";
+        const string pids = procs.empty() ? std::to_string(pid) : join_pids(procs);
+        return sysrun(script, pids, get_cgroup2_path(root_dir), "cont_" + std::to_string(pid)) == 0;
+    }
+
+    string join_pids(const std::set<pid_t>& pids)
+    {
+        string result;
+        for (auto pid : pids) {
+            result += (result.empty() ? "" : " ") + std::to_string(pid);
+        }
+        return result;
+    }
+
+    std::map<string, uint64_t> read_cgroup_stat(const string& path)
+    {
+        std::map<string, uint64_t> values;
+        std::ifstream in(path);
+        string key;
+        uint64_t value;
+        while (in >> key >> value) {
+            values[key] = value;
+        }
+        return values;
+    }
+
+    uint64_t read_pressure_stall_us(const string& path)
+    {
+        std::ifstream in(path);
+        string field;
+        while (in >> field) {
+            if (field.compare(0, 6, "total=") == 0) {
+                return std::stoull(field.substr(6)); // first total is of `some` line
+            }
+        }
+        return 0;
+    }
+
+    bool set_cont_cpu_limit(const string& root_dir, const container_t& cont, int cpu_perc)
+    {
+        const string cpu_max_file = get_cont_cgroup2_dir(root_dir, cont.pid) + "/cpu.max";
+        if (access(cpu_max_file.c_str(), W_OK) == 0) {
+            auto quota = host_cpus() * cpu_perc * cpu_max_period_us / 100;
+            return write_cgroup_file(cpu_max_file, std::to_string(quota) + " " + std::to_string(cpu_max_period_us));
+        }
+        const string cg_dir = get_cpu_cgroup_path(root_dir) + "/" + get_cont_cpu_cgroup(cont);
+        auto period = read_cgroup_file(cg_dir + "/cpu.cfs_period_us");
+        if (period.empty()) {
+            return false;
+        }
+        auto quota = host_cpus() * cpu_perc * std::stoull(period) / 100;
+        return write_cgroup_file(cg_dir + "/cpu.cfs_quota_us", std::to_string(quota));
+    }
+
+    int get_cont_cpu_limit(const string& root_dir, const container_t& cont)
+    {
+        uint64_t quota = 0;
+        uint64_t period = 0;
+        std::ifstream cpu_max(get_cont_cgroup2_dir(root_dir, cont.pid) + "/cpu.max");
+        string quota_str;
+        if (cpu_max >> quota_str >> period) {
+            if (quota_str == "max") {
+                return 100;
+            }
+            quota = std::stoull(quota_str);
+        } else {
+            const string cg_dir = get_cpu_cgroup_path(root_dir) + "/" + get_cont_cpu_cgroup(cont);
+            auto quota_value = read_cgroup_file(cg_dir + "/cpu.cfs_quota_us");
+            auto period_value = read_cgroup_file(cg_dir + "/cpu.cfs_period_us");
+            if (quota_value.empty() || period_value.empty()) {
+                return -1;
+            }
+            if (quota_value == "-1") {
+                return 100;
+            }
+            quota = std::stoull(quota_value);
+            period = std::stoull(period_value);
+        }
+        return period == 0 ? -1 : static_cast<int>((quota * 100 + period * host_cpus() / 2) / (period * host_cpus()));
+    }
+
+    bool set_cont_memory_high(const string& root_dir, pid_t pid, uint64_t bytes)
+    {
+        const string high_file = get_cont_cgroup2_dir(root_dir, pid) + "/memory.high";
+        return access(high_file.c_str(), W_OK) == 0 && write_cgroup_file(high_file, std::to_string(bytes));
+    }
+
+    uint64_t get_cont_memory_high(const string& root_dir, pid_t pid)
+    {
+        auto value = read_cgroup_file(get_cont_cgroup2_dir(root_dir, pid) + "/memory.high");
+        if (value.empty()) {
+            return 0;
+        }
+        return value == "max" ? UINT64_MAX : std::stoull(value);
+    }
+}
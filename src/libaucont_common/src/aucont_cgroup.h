@@ -0,0 +1,89 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <sys/types.h>
+
+#include "aucont_common.h"
+
+namespace aucont
+{
+    /**
+     * returns path, where cpu cgroup (v1) hierarchy is mounted
+     * @param root_dir aucont root dir
+     */
+    std::string get_cpu_cgroup_path(const std::string& root_dir);
+
+    /**
+     * returns name of container's cpu cgroup (v1): container with adaptive cpu
+     * limit has its own cgroup, others share cgroup of their cpu percentage
+     */
+    std::string get_cont_cpu_cgroup(const container_t& cont);
+
+    /**
+     * returns path, where cgroup v2 hierarchy is mounted (on first container start)
+     * @param root_dir aucont root dir
+     */
+    std::string get_cgroup2_path(const std::string& root_dir);
+
+    /**
+     * returns cgroup v2 directory of container; it exists only if kernel has
+     * cgroup v2 and container has adaptive limits or was started with
+     * `pressure_events`. Container gets its own cgroup there for pressure (PSI)
+     * and events (`cgroup.events`, `memory.events`) of its processes only
+     */
+    std::string get_cont_cgroup2_dir(const std::string& root_dir, pid_t pid);
+
+    /**
+     * Creates cgroup v2 for container and moves its init there; processes
+     * run by aucont_exec are added there too
+     * @param procs all processes of restored container to move there, empty - only init
+     * @return false if cgroup v2 is not available
+     */
+    bool setup_cont_cgroup2(const std::string& root_dir, pid_t pid, const std::set<pid_t>& procs = std::set<pid_t>());
+
+    /**
+     * returns pids separated with spaces, as cgroup setup scripts take them
+     */
+    std::string join_pids(const std::set<pid_t>& pids);
+
+    /**
+     * reads cgroup flat keyed file (like `cpu.stat`), missing file gives no keys
+     */
+    std::map<std::string, uint64_t> read_cgroup_stat(const std::string& path);
+
+    /**
+     * returns total time (in microseconds), when some of cgroup processes were
+     * stalled on resource: `some total` of PSI file (`cpu.pressure`, ...), 0 if unknown
+     */
+    uint64_t read_pressure_stall_us(const std::string& path);
+
+    /**
+     * Sets cpu limit (percent of host cpu time, as `--cpu`) of container with
+     * adaptive limit: `cpu.max` of its cgroup v2 if cpu controller is enabled
+     * there, quota of its own cpu cgroup (v1) otherwise
+     * @return false if container has no cgroup to limit
+     */
+    bool set_cont_cpu_limit(const std::string& root_dir, const container_t& cont, int cpu_perc);
+
+    /**
+     * returns cpu limit of container with adaptive limit (see `set_cont_cpu_limit`)
+     * or -1 if there is no such
+     */
+    int get_cont_cpu_limit(const std::string& root_dir, const container_t& cont);
+
+    /**
+     * Sets `memory.high` of container's cgroup v2: processes are throttled and
+     * their memory is reclaimed above it
+     * @return false if memory controller is not enabled in cgroup v2
+     */
+    bool set_cont_memory_high(const std::string& root_dir, pid_t pid, uint64_t bytes);
+
+    /**
+     * returns `memory.high` of container's cgroup v2 (UINT64_MAX for `max`)
+     * or 0 if memory controller is not enabled there
+     */
+    uint64_t get_cont_memory_high(const std::string& root_dir, pid_t pid);
+}
@@ -0,0 +1,165 @@
+#include "aucont_checkpoint.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <cerrno>
+#include <climits>
+#include <ctime>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/wait.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        // exit codes of checkpoint_cont.sh
+        const int no_criu_code = 2;
+        const int snapshot_exists_code = 4;
+
+        bool is_tty(dev_t rdev)
+        {
+            auto dev_major = major(rdev);
+            // virtual consoles and serial ttys, /dev/tty and ptmx, pseudo terminals
+            return dev_major == 4 || dev_major == 5 || (dev_major >= 136 && dev_major <= 143);
+        }
+
+        int read_mnt_id(pid_t pid, int fd)
+        {
+            std::ifstream in("/proc/" + std::to_string(pid) + "/fdinfo/" + std::to_string(fd));
+            string key;
+            int value = -1;
+            while (in >> key) {
+                if (key == "mnt_id:" && in >> value) {
+                    break;
+                }
+            }
+            return value;
+        }
+
+        /**
+         * returns CRIU key of host object, which init stdio fd refers to:
+         * `pipe:[inode]`, `tty[rdev:dev]` or `file[mnt_id:inode]` (hex), empty
+         * for closed fd and for objects CRIU dumps itself (sockets, anon inodes)
+         */
+        string get_stdio_key(pid_t pid, int fd)
+        {
+            const string fd_path = "/proc/" + std::to_string(pid) + "/fd/" + std::to_string(fd);
+            char buf[PATH_MAX];
+            ssize_t len = readlink(fd_path.c_str(), buf, sizeof(buf) - 1);
+            if (len <= 0) {
+                return "";
+            }
+            string target(buf, len);
+            if (target.compare(0, 5, "pipe:") == 0) {
+                return target;
+            }
+            struct stat st;
+            if (target[0] != '/' || stat(fd_path.c_str(), &st) != 0) {
+                return "";
+            }
+            std::stringstream key;
+            key << std::hex;
+            if (S_ISCHR(st.st_mode) && is_tty(st.st_rdev)) {
+                key << "tty[" << st.st_rdev << ":" << st.st_dev << "]";
+            } else {
+                key << "file[" << read_mnt_id(pid, fd) << ":" << st.st_ino << "]";
+            }
+            return key.str();
+        }
+    }
+
+    string get_snapshots_path(const string& root_dir)
+    {
+        return root_dir + "/snapshots";
+    }
+
+    string checkpoint_container(const string& root_dir, const container_t& cont, const checkpoint_options& opts)
+    {
+        const string pid = std::to_string(cont.pid);
+        if (cont.paused) {
+            throw_error("Container " + pid + " is paused, it must be resumed before checkpoint", EBUSY);
+        }
+        if (opts.pre_dumps < 0) {
+            throw_error("Number of pre-dumps can't be negative");
+        }
+        const string spec_path = get_spec_path(root_dir, cont.pid);
+        if (access(spec_path.c_str(), F_OK) != 0) {
+            throw_error("Container " + pid + " has no spec, it wasn't started by this aucont", ENOENT);
+        }
+        auto spec = load_spec(spec_path);
+        if (spec.opts.exec_agent) {
+            throw_error("Container with exec agent can't be checkpointed: agent socket is bound on host", ENOTSUP);
+        }
+        const string name = opts.name.empty() ? pid + "-" + std::to_string(time(nullptr)) : opts.name;
+        if (name.find('/') != string::npos || name == "." || name == "..") {
+            throw_error("Bad snapshot name [ " + name + " ]");
+        }
+
+        std::map<string, string> meta = {
+            { "checkpoint_pid", pid },
+            { "checkpoint_cpu_perc", std::to_string(cont.cpu_perc) },
+            { "checkpoint_readiness", std::to_string(cont.readiness) },
+        };
+        string externals;
+        for (int fd = 0; fd < 3; ++fd) {
+            auto key = get_stdio_key(cont.pid, fd);
+            meta["stdio" + std::to_string(fd)] = key;
+            // pipes need no declaration on dump, only replacement on restore
+            if (!key.empty() && key.compare(0, 5, "pipe:") != 0 && externals.find(key) == string::npos) {
+                externals += key + " ";
+            }
+        }
+
+        const string script = root_dir + "/checkpoint_cont.sh";
+        // keys look like glob patterns, so their list goes quoted (not last)
+        int ret = sysrun(script, cont.pid, get_snapshots_path(root_dir), name, opts.pre_dumps, externals,
+                         opts.leave_running ? 1 : 0);
+        const string snapshot = get_snapshots_path(root_dir) + "/" + name;
+        if (ret != 0) {
+            int code = WIFEXITED(ret) ? WEXITSTATUS(ret) : -1;
+            if (code == no_criu_code) {
+                throw_error("Checkpoint requires CRIU (`criu` is not found)", ENOTSUP);
+            } else if (code == snapshot_exists_code) {
+                throw_error("Snapshot already exists [ " + snapshot + " ]", EEXIST);
+            }
+            throw_error("Can't checkpoint container " + pid + " (see CRIU logs in " + snapshot + ")");
+        }
+        // snapshot without meta is incomplete, so meta goes last
+        save_spec(snapshot + "/meta", spec, meta);
+        return snapshot;
+    }
+
+    snapshot_t load_snapshot(const string& root_dir, const string& snapshot)
+    {
+        snapshot_t result;
+        result.path = snapshot.find('/') == string::npos ? get_snapshots_path(root_dir) + "/" + snapshot : snapshot;
+        const string meta_path = result.path + "/meta";
+        if (access(meta_path.c_str(), F_OK) != 0 || access((result.path + "/images").c_str(), F_OK) != 0) {
+            throw_error("There is no complete snapshot [ " + result.path + " ]", ENOENT);
+        }
+        std::map<string, string> meta;
+        result.spec = load_spec(meta_path, &meta);
+        const auto& opts = result.spec.opts;
+        try {
+            result.cont = container_t(std::stoi(meta["checkpoint_pid"]), std::stoi(meta["checkpoint_cpu_perc"]));
+            result.cont.readiness = std::stoi(meta["checkpoint_readiness"]);
+        } catch (const std::logic_error&) {
+            throw_error("Bad snapshot meta [ " + meta_path + " ]");
+        }
+        result.cont.cpu_min = opts.cpu_min;
+        result.cont.cpu_max = opts.cpu_max;
+        result.cont.mem_min = opts.mem_min;
+        result.cont.mem_max = opts.mem_max;
+        for (int fd = 0; fd < 3; ++fd) {
+            result.stdio[fd] = meta["stdio" + std::to_string(fd)];
+        }
+        return result;
+    }
+}
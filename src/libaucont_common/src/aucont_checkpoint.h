@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+
+#include <sys/types.h>
+
+#include "aucont_common.h"
+#include "aucont_runtime.h"
+#include "aucont_spec.h"
+
+namespace aucont
+{
+    /**
+     * Containers are checkpointed with CRIU (`criu` is run with sudo by
+     * checkpoint_cont.sh and restore_cont.sh). Snapshots are kept in
+     * `root_dir/snapshots`, which is tmpfs mounted on first checkpoint, so
+     * neither dump nor restore touches disk. Snapshot dir contains:
+     *   meta   - container spec (see aucont_spec.h), its registry entry and
+     *            CRIU keys of init stdio
+     *   pre<N> - incremental pre-dumps: memory pages changed since previous
+     *            one, written while container keeps running
+     *   images - final dump (only pages changed since last pre-dump)
+     * Init stdio are host objects (/dev/null of daemonized container, log pipe,
+     * terminal of caller), so they are dumped as external ones and replaced on
+     * restore: stdin with /dev/null, output with new log pipe or /dev/null.
+     * Cgroups are not dumped: restored container gets its own ones, like
+     * started container, and veth gets host end named after its new pid
+     */
+    struct snapshot_t
+    {
+        std::string path;
+        container_spec spec;
+        container_t cont;       // registry entry of container at checkpoint
+        std::string stdio[3];   // CRIU keys of init stdin, stdout and stderr, empty - dumped by CRIU
+    };
+
+    /**
+     * returns path, where snapshots tmpfs is mounted
+     * @param root_dir aucont root dir
+     */
+    std::string get_snapshots_path(const std::string& root_dir);
+
+    /**
+     * Dumps running container into new snapshot. Throws aucont_error on failure
+     * @param cont registry entry of container
+     * @return snapshot path
+     */
+    std::string checkpoint_container(const std::string& root_dir, const container_t& cont,
+                                     const checkpoint_options& opts);
+
+    /**
+     * Reads snapshot, given by path or by name (in snapshots dir). Throws
+     * aucont_error on failure (ENOENT if there is no complete snapshot)
+     */
+    snapshot_t load_snapshot(const std::string& root_dir, const std::string& snapshot);
+}
@@ -1,172 +1,139 @@
 #include "aucont_common.h"
 
 #include <sstream>
-#include <fstream>
 #include <iostream>
 #include <stdexcept>
-#include <functional>
-#include <numeric>
+#include <vector>
 
 #include <cerrno>
 #include <cstring>
-#include <cstring>
-#include <csignal>
+#include <cstdlib>
 #include <cstdint>
+#include <ctime>
 
 #include <unistd.h>
+#include <dirent.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 
 namespace aucont
 {
-    namespace 
+    void throw_error(std::string msg, int code)
     {
-        std::string aucont_dir = "/usr/share/aucont";
-        std::string pids_file = aucont_dir + "/containers";
-        std::string cgrouph_dir = aucont_dir + "/cgrouph";
-
-        bool not_exist(std::string filename) {
-            struct stat st;
-            if (stat(filename.c_str(), &st) < 0 && errno == ENOENT) {
-                return true;
-            }
-            return false;
-        }
-
-    
-        void prepare()
-        {
-            if (not_exist(aucont_dir)) {
-                int result = mkdir(aucont_dir.c_str(), 0777);
-                if (result != 0) {
-                    std::stringstream ss;
-                    ss << "Can't create direcotry [ " << aucont_dir << " ], " << "error code = [ " << errno << " ]: " << strerror(errno); 
-                    throw std::runtime_error(ss.str());
-                }
-            }
-        }
-        
-        /**
-         * rewrites pids_file completely with given set of pids
-         */
-        void write_containters(const std::set<container_t>& conts)
-        {
-            prepare();
-            std::ofstream out(pids_file.c_str(), std::ios_base::trunc | std::ios_base::out | std::ios_base::binary);
-            if (out.fail()) {
-                std::stringstream ss;
-                ss << "Can't open file with containers pids for write [ " << strerror(errno) << " ]";
-                throw std::runtime_error(ss.str());
-            }
-            for (auto& cont : conts) {
-                out.write(reinterpret_cast<const char*>(&cont), sizeof(container_t) / sizeof(char));
-            }
-        }
-
-        bool is_proc_dead(pid_t pid)
-        {
-            return kill(pid, 0) == -1 && errno == ESRCH;
-        }
+        throw aucont_error(code, msg);
     }
 
-    std::string get_cgrouph_path() 
+    void throw_stdlib_error(std::string msg)
     {
-        return cgrouph_dir;
+        int code = errno;
+        std::stringstream ss;
+        ss << msg << " [ " << strerror(code) << " ]";
+        throw aucont_error(code, ss.str());
     }
 
-    std::string get_pids_path()
+    std::string get_cgroup_for_cpuperc(uint8_t cpu_perc)
     {
-        return pids_file;
+        return "cpu_restricted_" + std::to_string((int) cpu_perc);
     }
 
-    std::set<container_t> get_containers()
-    {
-        if (not_exist(pids_file)) {
-            return std::set<container_t>();
-        }
-        std::ifstream in(pids_file.c_str(), std::ios_base::in | std::ios_base::binary);
-        if (in.fail()) {
-            std::stringstream ss;
-            ss << "Can't open file with containers info for read [ " << strerror(errno) << " ]";
-            throw std::runtime_error(ss.str());
-        }
-        std::set<container_t> conts;
-        container_t cont;
-
-        while (in.read(reinterpret_cast<char*>(&cont), sizeof(container_t) / sizeof(char))) {
-            if (!is_proc_dead(cont.pid)) {
-                conts.insert(cont);
-            }
-        }
-        write_containters(conts);
-        return conts;
-    }
+    // utility functions
 
-    container_t get_container(pid_t pid)
+    std::string get_real_path(std::string file_path)
     {
-        auto conts = get_containers();
-        auto it = conts.find(container_t(pid));
-        if (it == conts.end()) {
-            return container_t();
-        } else {
-            return *it;
+        char path_to_file[1000];
+        if (realpath(file_path.c_str(), path_to_file) == NULL) {
+            throw_stdlib_error("Can't get real path for [ " + file_path + " ]");
         }
+        return std::string(path_to_file);
     }
 
-    bool add_container(const container_t& cont)
+    std::string get_file_real_dir(std::string file_path)
     {
-        auto conts = get_containers();
-        auto sz = conts.size();
-        conts.insert(cont);
-        if (sz == conts.size()) {
-            return false;
-        }
-        write_containters(conts);
-        return true;
+        std::string path = get_real_path(file_path);
+        path = path.substr(0, path.find_last_of("/")) + "/";
+        return path;
     }
 
-    bool del_container(pid_t pid)
+    std::string get_exe_dir()
     {
-        auto conts = get_containers();
-        auto it = conts.find(container_t(pid));
-        if (it == conts.end()) {
-            return false;
-        } 
-        conts.erase(it);
-        write_containters(conts);
-        return true;
+        return get_file_real_dir("/proc/self/exe");
     }
 
-    std::string get_cgroup_for_cpuperc(uint8_t cpu_perc)
+    int open_pidfd(pid_t pid)
     {
-        return "cpu_restricted_" + std::to_string((int) cpu_perc);
+        // pidfd fds are always close-on-exec
+        return syscall(SYS_pidfd_open, pid, 0);
     }
 
-    void set_aucont_root(std::string root_dir)
+    std::set<pid_t> get_container_procs(pid_t pid)
     {
-        if (root_dir[root_dir.length() - 1] == '/') {
-            root_dir = root_dir.substr(0, root_dir.length() - 1);
+        char buf[64];
+        std::string ns_link = "/proc/" + std::to_string(pid) + "/ns/pid";
+        ssize_t len = readlink(ns_link.c_str(), buf, sizeof(buf) - 1);
+        if (len < 0) {
+            throw_stdlib_error("Can't read pid namespace of container " + std::to_string(pid));
         }
-        aucont_dir = root_dir;
-        pids_file = aucont_dir + "/containers";
-        cgrouph_dir = aucont_dir + "/cgrouph";
-    }
+        std::string cont_ns(buf, len);
 
-    // utility functions
+        std::set<pid_t> procs;
+        DIR* proc = opendir("/proc");
+        if (proc == nullptr) {
+            throw_stdlib_error("Can't read /proc");
+        }
+        while (auto entry = readdir(proc)) {
+            pid_t proc_pid = std::atoi(entry->d_name);
+            if (proc_pid <= 0) {
+                continue;
+            }
+            std::string link = std::string("/proc/") + entry->d_name + "/ns/pid";
+            len = readlink(link.c_str(), buf, sizeof(buf) - 1);
+            if (len > 0 && cont_ns == std::string(buf, len)) {
+                procs.insert(proc_pid);
+            }
+        }
+        closedir(proc);
+        return procs;
+    }
 
-    std::string get_real_path(std::string file_path)
+    int64_t monotonic_ms()
     {
-        char path_to_file[1000];
-        if (realpath(file_path.c_str(), path_to_file) == NULL) {
-            throw std::runtime_error("Can't get real path for [ " + file_path + " ]");
-        }
-        return std::string(path_to_file);
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
     }
 
-    std::string get_file_real_dir(std::string file_path)
+    int close_inherited_fds(int keep_fd)
     {
-        std::string path = get_real_path(file_path);
-        path = path.substr(0, path.find_last_of("/")) + "/";
-        return path;
+        const int first_fd = STDERR_FILENO + 1;
+        if (keep_fd >= 0 && keep_fd != first_fd) {
+            if (dup2(keep_fd, first_fd) < 0) {
+                throw_stdlib_error("Can't move inherited fd");
+            }
+            keep_fd = first_fd;
+        }
+        const int close_from = keep_fd >= 0 ? first_fd + 1 : first_fd;
+#ifdef SYS_close_range
+        if (syscall(SYS_close_range, close_from, ~0U, 0) == 0) {
+            return keep_fd;
+        }
+#endif
+        // kernel without close_range (before 5.9)
+        std::vector<int> fds;
+        DIR* dir = opendir("/proc/self/fd");
+        if (dir == nullptr) {
+            throw_stdlib_error("Can't list inherited fds");
+        }
+        while (auto entry = readdir(dir)) {
+            int fd = atoi(entry->d_name);
+            if (fd >= close_from && fd != dirfd(dir)) {
+                fds.push_back(fd);
+            }
+        }
+        closedir(dir);
+        for (auto fd : fds) {
+            close(fd);
+        }
+        return keep_fd;
     }
 
     void error(std::string msg)
@@ -182,5 +149,13 @@ namespace aucont
         std::cerr << ss.str() << std::endl;
         exit(1);
     }
-}
 
+    void child_fail(const std::exception& err)
+    {
+        std::string msg = std::string("AUCONT_ERROR: ") + err.what() + "\n";
+        if (write(STDERR_FILENO, msg.c_str(), msg.size()) < 0) {
+            // nothing to do, exiting anyway
+        }
+        _exit(1);
+    }
+}
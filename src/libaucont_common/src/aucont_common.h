@@ -1,23 +1,57 @@
+#pragma once
+
 #include <string>
 #include <set>
 #include <iostream>
 #include <type_traits>
 #include <vector>
 #include <sstream>
+#include <stdexcept>
 
 #include <cstdint>
+#include <cstring>
+#include <cerrno>
 
 #include <unistd.h>
 #include <sys/types.h>
 
+/**
+ * Entry point of aucont tool: `main` for standalone `aucont_<tool>` binary,
+ * `aucont_<tool>_main` when tool is linked into multi-call `aucont` binary
+ */
+#ifdef AUCONT_MULTICALL
+#define AUCONT_TOOL_MAIN(tool) aucont_##tool##_main
+#else
+#define AUCONT_TOOL_MAIN(tool) main
+#endif
+
 namespace aucont
 {
+    /**
+     * Readiness of container workload (see `Runtime::wait_ready`)
+     */
+    enum readiness_t: uint8_t
+    {
+        readiness_untracked, // container has no readiness probe
+        readiness_starting,  // workload hasn't reported readiness yet
+        readiness_ready,
+        readiness_failed     // workload wasn't ready in time or exited before it
+    };
+
     struct container_t
     {
         pid_t pid;
-        uint8_t cpu_perc;
-
-        container_t(pid_t pid = -1, uint8_t cpu_perc = 100): pid(pid), cpu_perc(cpu_perc) 
+        uint8_t cpu_perc; // initial cpu limit, current one differs for adaptive limit
+        bool paused;      // frozen with aucont_pause
+        uint8_t cpu_min;  // bounds of adaptive cpu limit (see aucont_autoscale.h), 0 - limit is static
+        uint8_t cpu_max;
+        uint64_t mem_min; // bounds of adaptive memory limit in bytes, 0 - memory is not limited
+        uint64_t mem_max;
+        uint8_t readiness; // readiness_t
+
+        container_t(pid_t pid = -1, uint8_t cpu_perc = 100)
+        : pid(pid), cpu_perc(cpu_perc), paused(false), cpu_min(0), cpu_max(0), mem_min(0), mem_max(0),
+          readiness(readiness_untracked)
         {}
 
         bool operator<(const container_t& other) const
@@ -32,39 +66,36 @@ namespace aucont
     };
 
     /**
-     * writes given container info to file  
+     * Error of aucont library operation; `code()` is errno-like value
      */
-    bool add_container(const container_t& cont);
-
-    /**
-     * deletes given PID from file with container info, 
-     * if it (container with such pid) exists
-     */
-    bool del_container(pid_t pid); 
+    class aucont_error: public std::runtime_error
+    {
+    public:
+        aucont_error(int code, const std::string& msg): std::runtime_error(msg), err_code(code)
+        {}
 
-    container_t get_container(pid_t pid);
-    
-    std::set<container_t> get_containers();
+        int code() const
+        {
+            return err_code;
+        }
 
-    /**
-     * returns root path of cgroup hierarchy, which is mounted by aucont_start util
-     * during start of any container with cpu restrictions
-     */
-    std::string get_cgrouph_path();
+    private:
+        int err_code;
+    };
 
     /**
-     * returns file with cont pids
+     * throws aucont_error with given code and message
      */
-    std::string get_pids_path();
+    [[noreturn]] void throw_error(std::string msg, int code = EINVAL);
 
     /**
-     * sets up root directory for creating files (cgrouph, file with pids)
+     * throws aucont_error with current errno and its description added to message
      */
-    void set_aucont_root(std::string root_dir);
+    [[noreturn]] void throw_stdlib_error(std::string msg);
 
     /**
      * returns name of cgroup (folder, only top level) for given cpu_perc
-     * need for more convenient way of using cgroup names for containers 
+     * need for more convenient way of using cgroup names for containers
      * in aucont utils
      */
     std::string get_cgroup_for_cpuperc(uint8_t cpu_perc);
@@ -77,11 +108,44 @@ namespace aucont
      */
     std::string get_file_real_dir(std::string file_path);
 
+    /**
+     * returns absolute path to directory with running executable (symlinks
+     * are resolved, so for multi-call `aucont` it's where real binary lives)
+     * @return path to directory with '/' symbol at the end
+     */
+    std::string get_exe_dir();
+
     /**
      * returns absolute path to file
      */
     std::string get_real_path(std::string file_path);
 
+    /**
+     * returns pidfd (close-on-exec) referring to process with given pid
+     * or -1 on error with errno set (see `man 2 pidfd_open`)
+     */
+    int open_pidfd(pid_t pid);
+
+    /**
+     * returns pids (as seen from host) of all processes in pid namespace of
+     * container with given init process pid
+     */
+    std::set<pid_t> get_container_procs(pid_t pid);
+
+    /**
+     * returns milliseconds of monotonic clock (CLOCK_MONOTONIC)
+     */
+    int64_t monotonic_ms();
+
+    /**
+     * Closes all fds of forked (not exec'ing) child except stdio and `keep_fd`:
+     * caller may be multithreaded, so child holds fds of other threads (pipes,
+     * registry lock, sockets of host program). Throws aucont_error on failure
+     * @param keep_fd fd to keep or -1, it's moved to fd 3
+     * @return new number of `keep_fd`
+     */
+    int close_inherited_fds(int keep_fd = -1);
+
     /**
      * prints message to stderr and exit(1)
      */
@@ -92,6 +156,12 @@ namespace aucont
      */
     void stdlib_error(std::string msg);
 
+    /**
+     * Terminates forked child process of library after failure: prints message
+     * to stderr and calls _exit(1), so no atexit handlers of host program run
+     */
+    [[noreturn]] void child_fail(const std::exception& err);
+
     template<typename T>
     typename std::enable_if<std::is_pod<T>::value, T>::type read_from_pipe(int fd)
     {
@@ -101,10 +171,13 @@ namespace aucont
         while (offset != sizeof(T)) {
             ssize_t ret = read(fd, buf + offset, sizeof(T) - offset);
             if (ret < 0) {
-                stdlib_error("Can't read from pipe");
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_stdlib_error("Can't read from pipe");
             }
             if (ret == 0) {
-                error("pipe read returned 0");
+                throw_error("pipe read returned 0", EPIPE);
             }
             offset += ret;
         }
@@ -119,7 +192,10 @@ namespace aucont
         while (count > 0) {
             ssize_t ret = write(fd, buf, count);
             if (ret <= 0) {
-                stdlib_error("Can't write to pipe");
+                if (ret < 0 && errno == EINTR) {
+                    continue;
+                }
+                throw_stdlib_error("Can't write to pipe");
             }
             count -= ret;
             if (count > 0) {
@@ -156,4 +232,4 @@ namespace aucont
         std::string command = ss.str();
         return system(command.c_str());
     }
-}
\ No newline at end of file
+}
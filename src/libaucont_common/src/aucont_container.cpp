@@ -0,0 +1,986 @@
+#include "aucont_container.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/sendfile.h>
+#include <sys/mount.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "aucont_common.h"
+#include "aucont_cgroup.h"
+#include "aucont_freezer.h"
+#include "aucont_prewarm.h"
+#include "aucont_log_collector.h"
+#include "aucont_ready.h"
+#include "aucont_agent.h"
+#include "aucont_checkpoint.h"
+#include "aucont_spec.h"
+
+namespace aucont
+{
+    using std::string;
+    using std::stringstream;
+    using std::vector;
+
+    namespace
+    {
+        const int container_ns_flags = CLONE_NEWNET | CLONE_NEWNS | CLONE_NEWUTS | CLONE_NEWUSER | CLONE_NEWIPC;
+        const uint64_t min_net_burst = 32 * 1024; // room for a couple of GSO packets
+        // container, which failed to start, exits on its own, once its pipe is closed
+        const int failed_exit_timeout_ms = 1000;
+
+        struct cont_params
+        {
+            const options& opts;
+            int in_pipe_fd;
+            int out_pipe_fd;
+            int log_pipe_fd; // write end of output pipe or -1 if output is not captured
+            int ready_fd;    // command's end of readiness socket or -1
+            int agent_fd;    // exec agent socket, inherited by init, or -1
+            vector<int> fds_to_close;
+            string scripts_path;
+        };
+
+        /**
+         * Configures filesystem of container from host side
+         * @param path to container root directory
+         */
+        void setup_fs_host(string cont_root)
+        {
+            (void) cont_root;
+            // stringstream cmdss;
+            // cmdss << "chown -R " << geteuid() << ":" << getegid() << " " << cont_root;
+            // auto cmd = cmdss.str();
+            // if (system(cmd.c_str()) != 0) {
+            //     aucont::error("Can't setup container root dir permissions");
+            // }
+        }
+
+        /**
+         * One entry of container mount template: filesystem (or host path bind)
+         * which is mounted at `target` (relative to container root)
+         */
+        struct mount_tmpl_entry
+        {
+            const char* target;
+            const char* fstype;   // nullptr for bind of `bind_src`
+            const char* bind_src;
+            const char* mode;     // tmpfs `mode` option or nullptr
+            unsigned int attrs;   // MOUNT_ATTR_* flags
+            mode_t mnt_point;     // 0 if mount point must exist in image, S_IFDIR/S_IFREG to create it
+        };
+
+        const unsigned int special_fs_attrs = MOUNT_ATTR_NOSUID | MOUNT_ATTR_NOEXEC | MOUNT_ATTR_NODEV;
+
+        /**
+         * Special filesystems skeleton mounted into every container. Entries are
+         * attached in order, so parent mounts go first. Mount points, which are
+         * not in the image, are created inside `dev` tmpfs, so image is never modified
+         */
+        const mount_tmpl_entry mount_template[] = {
+            { "proc",        "proc",   nullptr,        nullptr, special_fs_attrs,                      0       },
+            { "sys",         "sysfs",  nullptr,        nullptr, special_fs_attrs,                      0       },
+            { "dev",         "tmpfs",  nullptr,        "755",   MOUNT_ATTR_NOSUID | MOUNT_ATTR_NOEXEC, 0       },
+            { "dev/zero",    nullptr,  "/dev/zero",    nullptr, 0,                                     S_IFREG },
+            { "dev/null",    nullptr,  "/dev/null",    nullptr, 0,                                     S_IFREG },
+            { "dev/full",    nullptr,  "/dev/full",    nullptr, 0,                                     S_IFREG },
+            { "dev/random",  nullptr,  "/dev/random",  nullptr, 0,                                     S_IFREG },
+            { "dev/urandom", nullptr,  "/dev/urandom", nullptr, 0,                                     S_IFREG },
+            { "dev/tty",     nullptr,  "/dev/tty",     nullptr, 0,                                     S_IFREG },
+            { "dev/shm",     "tmpfs",  nullptr,        "1777",  MOUNT_ATTR_NOSUID | MOUNT_ATTR_NODEV,  S_IFDIR },
+            { "dev/mqueue",  "mqueue", nullptr,        nullptr, special_fs_attrs,                      S_IFDIR },
+        };
+        const size_t mount_template_size = sizeof(mount_template) / sizeof(mount_template[0]);
+
+        /**
+         * Standard symlinks of `dev` tmpfs, created after template is attached
+         * (link path relative to container root, target)
+         */
+        const char* const dev_symlinks[][2] = {
+            { "dev/fd",     "/proc/self/fd"   },
+            { "dev/stdin",  "/proc/self/fd/0" },
+            { "dev/stdout", "/proc/self/fd/1" },
+            { "dev/stderr", "/proc/self/fd/2" },
+        };
+
+        /**
+         * Detached (not yet attached anywhere) mount tree of container:
+         * clone of image root and mounts for every `mount_template` entry
+         */
+        struct mount_tree
+        {
+            int root_fd;
+            int fds[mount_template_size];
+        };
+
+        /**
+         * Creates new detached mount of given filesystem
+         * @return mount fd, ready to be attached with `move_mount`
+         */
+        int make_detached_fs(const mount_tmpl_entry& entry)
+        {
+            int fs_fd = fsopen(entry.fstype, FSOPEN_CLOEXEC);
+            if (fs_fd < 0) {
+                throw_stdlib_error(string("Can't open filesystem context for ") + entry.fstype);
+            }
+            if (entry.mode != nullptr && fsconfig(fs_fd, FSCONFIG_SET_STRING, "mode", entry.mode, 0) != 0) {
+                throw_stdlib_error(string("Can't configure ") + entry.fstype + " mode");
+            }
+            if (fsconfig(fs_fd, FSCONFIG_CMD_CREATE, nullptr, nullptr, 0) != 0) {
+                throw_stdlib_error(string("Can't create ") + entry.fstype + " superblock");
+            }
+            int mnt_fd = fsmount(fs_fd, FSMOUNT_CLOEXEC, entry.attrs);
+            if (mnt_fd < 0) {
+                throw_stdlib_error(string("Can't create ") + entry.fstype + " mount");
+            }
+            close(fs_fd);
+            return mnt_fd;
+        }
+
+        /**
+         * Recursively copies contents of directory `src_fd` into directory `dst_fd`.
+         * Regular files, directories and symlinks are copied (with permissions),
+         * other special files are skipped
+         */
+        void copy_tree(int src_fd, int dst_fd)
+        {
+            int dir_fd = dup(src_fd);
+            DIR* dir = dir_fd < 0 ? nullptr : fdopendir(dir_fd);
+            if (dir == nullptr) {
+                throw_stdlib_error("Can't read image directory");
+            }
+            while (auto entry = readdir(dir)) {
+                const char* name = entry->d_name;
+                if (!strcmp(name, ".") || !strcmp(name, "..")) {
+                    continue;
+                }
+                struct stat st;
+                if (fstatat(src_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    throw_stdlib_error(string("Can't stat image file ") + name);
+                }
+                mode_t perms = st.st_mode & 07777;
+                if (S_ISDIR(st.st_mode)) {
+                    if (mkdirat(dst_fd, name, 0700) != 0) {
+                        throw_stdlib_error(string("Can't create dir ") + name);
+                    }
+                    int from = openat(src_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    int to = openat(dst_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    if (from < 0 || to < 0) {
+                        throw_stdlib_error(string("Can't open dir ") + name);
+                    }
+                    copy_tree(from, to);
+                    if (fchmod(to, perms) != 0) {
+                        throw_stdlib_error(string("Can't set permissions of ") + name);
+                    }
+                    close(from);
+                    close(to);
+                } else if (S_ISREG(st.st_mode)) {
+                    int from = openat(src_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+                    int to = openat(dst_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+                    if (from < 0 || to < 0) {
+                        throw_stdlib_error(string("Can't open file ") + name);
+                    }
+                    off_t left = st.st_size;
+                    while (left > 0) {
+                        ssize_t ret = sendfile(to, from, nullptr, left);
+                        if (ret <= 0) {
+                            throw_stdlib_error(string("Can't copy file ") + name);
+                        }
+                        left -= ret;
+                    }
+                    if (fchmod(to, perms) != 0) {
+                        throw_stdlib_error(string("Can't set permissions of ") + name);
+                    }
+                    close(from);
+                    close(to);
+                } else if (S_ISLNK(st.st_mode)) {
+                    vector<char> target(st.st_size + 1, 0);
+                    if (readlinkat(src_fd, name, target.data(), st.st_size) < 0 ||
+                        symlinkat(target.data(), dst_fd, name) != 0) {
+                        throw_stdlib_error(string("Can't copy symlink ") + name);
+                    }
+                }
+            }
+            closedir(dir);
+        }
+
+        /**
+         * Creates detached tmpfs mount with copy of container image
+         */
+        int make_tmpfs_root(const string& root)
+        {
+            const mount_tmpl_entry tmpfs_root = { "", "tmpfs", nullptr, "755", MOUNT_ATTR_NOSUID, 0 };
+            int mnt_fd = make_detached_fs(tmpfs_root);
+            int src_fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (src_fd < 0) {
+                throw_stdlib_error("Can't open container root " + root);
+            }
+            copy_tree(src_fd, mnt_fd);
+            close(src_fd);
+            return mnt_fd;
+        }
+
+        /**
+         * Prepares whole container mount tree detached from any mount namespace.
+         * Needs only user, pid and net namespaces of container to be ready, so
+         * it may be done while host is still configuring the rest. Tree is built
+         * per container, not once: proc, sysfs and mqueue superblocks are bound
+         * to namespaces of their creator, and detached mount is consumed by
+         * `move_mount`, so shared skeleton would be cloned per container anyway
+         * @param root      path to container root directory (path in host fs)
+         * @param tmpfs_root if true, image is copied into memory instead of being bound
+         */
+        mount_tree prepare_mount_tree(const string& root, bool tmpfs_root)
+        {
+            mount_tree tree;
+            if (tmpfs_root) {
+                tree.root_fd = make_tmpfs_root(root);
+            } else {
+                tree.root_fd = open_tree(AT_FDCWD, root.c_str(), OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC | AT_RECURSIVE);
+            }
+            if (tree.root_fd < 0) {
+                throw_stdlib_error("Can't clone container root " + root);
+            }
+            for (size_t i = 0; i < mount_template_size; ++i) {
+                const auto& entry = mount_template[i];
+                if (entry.fstype != nullptr) {
+                    tree.fds[i] = make_detached_fs(entry);
+                } else {
+                    tree.fds[i] = open_tree(AT_FDCWD, entry.bind_src, OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC);
+                    if (tree.fds[i] < 0) {
+                        throw_stdlib_error(string("Can't clone ") + entry.bind_src);
+                    }
+                }
+            }
+            return tree;
+        }
+
+        /**
+         * Attaches prepared mount tree at container root and changes root to it
+         * @param root path to new containers root folder (path in host fs)
+         */
+        void setup_fs(const string& root, const mount_tree& tree)
+        {
+            // recursively making all mount points private
+            if (mount(NULL, "/", NULL, MS_PRIVATE | MS_REC, NULL) != 0) {
+                throw_stdlib_error("Can't make mount points private");
+            }
+
+            // new root must be a mount point for pivot_root
+            if (move_mount(tree.root_fd, "", AT_FDCWD, root.c_str(), MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+                throw_stdlib_error("Mounting new root failed!");
+            }
+            close(tree.root_fd);
+            int root_fd = open(root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+            if (root_fd < 0) {
+                throw_stdlib_error("Can't open new root " + root);
+            }
+
+            for (size_t i = 0; i < mount_template_size; ++i) {
+                const auto& entry = mount_template[i];
+                if (entry.mnt_point == S_IFDIR) {
+                    if (mkdirat(root_fd, entry.target, 0755) != 0 && errno != EEXIST) {
+                        throw_stdlib_error(string("Can't create dir ") + entry.target);
+                    }
+                } else if (entry.mnt_point == S_IFREG) {
+                    int fd = openat(root_fd, entry.target, O_CREAT | O_WRONLY | O_CLOEXEC, 0666);
+                    if (fd < 0 || close(fd) < 0) {
+                        throw_stdlib_error(string("Can't create file ") + entry.target);
+                    }
+                }
+                if (move_mount(tree.fds[i], "", root_fd, entry.target, MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+                    throw_stdlib_error(string("Can't mount ") + entry.target);
+                }
+                close(tree.fds[i]);
+            }
+            for (const auto& link : dev_symlinks) {
+                if (symlinkat(link[1], root_fd, link[0]) != 0) {
+                    throw_stdlib_error(string("Can't create symlink ") + link[0]);
+                }
+            }
+
+            // changing root; old root is stacked under the new one and detached right away
+            if (fchdir(root_fd) != 0) {
+                throw_stdlib_error("Can't change working directory");
+            }
+            close(root_fd);
+            if (syscall(SYS_pivot_root, ".", ".") != 0) {
+                throw_stdlib_error("Pivot root SYS call failed");
+            }
+            if (umount2(".", MNT_DETACH) != 0) {
+                throw_stdlib_error("Can't unmount old root");
+            }
+            if (chdir("/") != 0) {
+                throw_stdlib_error("Can't change working directory");
+            }
+        }
+
+        string get_cont_veth_name(pid_t container_pid)
+        {
+            stringstream ss;
+            ss << "cont_" << container_pid << "_veth";
+            return ss.str();
+        }
+
+        string get_host_veth_name(pid_t container_pid)
+        {
+            stringstream ss;
+            ss << "host_" << container_pid << "_veth";
+            return ss.str();   
+        }
+
+        string get_host_ip(string cont_ip)
+        {
+            struct in_addr addr;
+            inet_aton(cont_ip.c_str(), &addr);
+            return inet_ntoa(inet_makeaddr(inet_netof(addr), inet_lnaof(addr) + 1));
+        }
+
+        /**
+         * Configures container's side of networking interface
+         * @param cont_ip           container's process ip
+         * @param host_pipe_fd read end of pipe to get veth device name from host
+         */
+        void setup_net_cont(string scripts_path, string cont_ip, pid_t cont_pid)
+        {
+            const string script = scripts_path + "setup_net_cont.sh";
+
+            if (sysrun(script, get_cont_veth_name(cont_pid), cont_ip, get_host_ip(cont_ip)) < 0) {
+                throw_error("Can't setup networking (from container)");
+            }
+        }
+
+        /**
+         * Configure host's side of networking interface
+         * @param cont_ip      ip a.b.c.d, which will be assigned to container; host ip will be a.b.c.(d+1)
+         * @param cont_pid      container's process id
+         */
+        void setup_net_host(string scripts_path, string cont_ip, pid_t cont_pid)
+        {
+            const string script = scripts_path + "setup_net_host.sh";
+
+
+            if (sysrun(script, cont_pid, get_host_veth_name(cont_pid), get_cont_veth_name(cont_pid), 
+                        get_host_ip(cont_ip)) != 0) {
+                throw_error("Can't setup networking (from host)");
+            }
+        }
+
+        /**
+         * Installs qdiscs on both ends of container's veth (see setup_net_shaping.sh)
+         * @param cont_veth name of veth end inside container
+         */
+        void setup_net_shaping(string scripts_path, const options& opts, pid_t cont_pid, const string& cont_veth)
+        {
+            const string script = scripts_path + "setup_net_shaping.sh";
+
+            uint64_t burst = opts.net_burst;
+            if (burst == 0) {
+                // tbf needs at least rate / HZ bytes, 10 ms of traffic is enough for any HZ
+                burst = std::max<uint64_t>(opts.net_rate / 8 / 100, min_net_burst);
+            }
+            if (sysrun(script, cont_pid, get_host_veth_name(cont_pid), cont_veth, opts.net_rate, burst) != 0) {
+                throw_error("Can't setup network shaping");
+            }
+        }
+
+        /**
+         * Publishes container ports on host and sets priority of container traffic;
+         * rules are removed by kernel when container exits
+         */
+        void setup_net_rules(string scripts_path, const options& opts, pid_t cont_pid)
+        {
+            const string script = scripts_path + "setup_net_rules.sh";
+
+            stringstream ports;
+            for (const auto& port : opts.ports) {
+                ports << " " << port.host_port << ":" << port.cont_port << (port.udp ? "/udp" : "/tcp");
+            }
+            // port list is the last (not quoted) argument, so shell splits it
+            if (sysrun(script, cont_pid, get_host_veth_name(cont_pid), opts.ip, opts.net_prio, ports.str()) != 0) {
+                throw_error("Can't setup container network rules");
+            }
+        }
+
+        /**
+         * @param pids processes to move into cpu cgroup (space separated), init only if empty
+         */
+        void setup_cgroup(string root_dir, const container_t& cont, const string& pids = "")
+        {
+            const string script = root_dir + "/setup_cpu_cgroup.sh";
+            if (sysrun(script, (int) cont.cpu_perc, pids.empty() ? std::to_string(cont.pid) : pids,
+                       get_cpu_cgroup_path(root_dir), get_cont_cpu_cgroup(cont)) != 0) {
+                throw_error("Can't setup cpu restrictions");
+            }
+        }
+
+        /**
+         * Puts container into its cgroups and sets its limits. Adaptive cpu limit
+         * is `cpu.max` of container cgroup v2, when cpu controller is enabled there
+         * (it's the only option on cgroup v2 only host), v1 cpu cgroup is used otherwise
+         * @param pressure_events container gets cgroup v2 even without adaptive limits
+         * @param procs all processes of restored container, empty - only init
+         */
+        void setup_cont_limits(const string& root_dir, const container_t& cont, bool pressure_events,
+                               const std::set<pid_t>& procs = std::set<pid_t>())
+        {
+            // others get no cgroup v2, so plain start runs no sudo for it
+            if ((cont.cpu_max > 0 || cont.mem_max > 0) && !setup_cont_cgroup2(root_dir, cont.pid, procs)) {
+                throw_error("Adaptive limits require cgroup v2 (pressure and usage of container are read there)");
+            }
+            if (pressure_events && cont.cpu_max == 0 && cont.mem_max == 0 &&
+                !setup_cont_cgroup2(root_dir, cont.pid, procs)) {
+                throw_error("Pressure events require cgroup v2");
+            }
+            const string cpu_max_file = get_cont_cgroup2_dir(root_dir, cont.pid) + "/cpu.max";
+            if (cont.cpu_max > 0 && access(cpu_max_file.c_str(), W_OK) == 0) {
+                if (!set_cont_cpu_limit(root_dir, cont, cont.cpu_perc)) {
+                    throw_error("Can't setup cpu restrictions");
+                }
+            } else if (cont.cpu_perc != 100 || cont.cpu_max > 0) {
+                setup_cgroup(root_dir, cont, procs.empty() ? "" : join_pids(procs));
+            }
+            if (cont.mem_max > 0 && !set_cont_memory_high(root_dir, cont.pid, cont.mem_max)) {
+                throw_error("Memory limit requires cgroup v2 memory controller");
+            }
+        }
+
+        void map_id(string file, vector<std::tuple<uid_t, uid_t, uid_t>> mappings)
+        {
+            std::ofstream out(file);
+            if (!out) {
+                throw_error("Can't open file " + file);
+            }
+            for (auto m : mappings) {
+                out << std::get<0>(m) << " " << std::get<1>(m) << " " << std::get<2>(m) << std::endl;
+            }
+        }
+
+        /**
+         * called from host
+         */
+        void setup_user_in_container(pid_t cont_pid)
+        {
+            // comment stolen from unshare sources
+            /* since Linux 3.19 unprivileged writing of /proc/self/gid_map
+             * has s been disabled unless /proc/self/setgroups is written
+             * first to permanently disable the ability to call setgroups
+             * in that user namespace. */
+            string cont_pid_str = std::to_string(cont_pid);
+            std::ofstream out("/proc/" + cont_pid_str + "/setgroups");
+            out << "deny";
+            out.close();
+            map_id("/proc/" + cont_pid_str + "/uid_map", { std::make_tuple(0, geteuid(), 1) });
+            map_id("/proc/" + cont_pid_str + "/gid_map", { std::make_tuple(0, getegid(), 1) });
+        }
+
+        void setup_uts()
+        {
+            const string hostname = "container";
+            if (sethostname(hostname.c_str(), hostname.length()) != 0) {
+                throw_stdlib_error("Can't set container hostname");
+            }
+        }
+
+        /**
+         * Daemonizes current process.
+         * Calling process (caller) will terminate during function execution
+         * `getpid()` after call not equal to `getpid()` before, because
+         * daemonized child process returns from this function (not caller)
+         */
+        void daemonize()
+        {
+            auto pid = fork();
+            if (pid < 0) {
+                throw_stdlib_error("Can't daemonize");
+            } else if (pid != 0) {
+                _exit(0);
+            }
+            if (setsid() < 0) {
+                throw_stdlib_error("Can't daemonize (setsid failed)");
+            }
+            // double forking not to be session leader (see `man 3 daemon`)
+            pid = fork();
+            if (pid < 0) {
+                throw_stdlib_error("Can't daemonize (second fork)");
+            } else if (pid != 0) {
+                _exit(0);
+            }
+            if (chdir("/") < 0) {
+                throw_stdlib_error("Can't daemonize (chdir failed)");
+            }
+            int fd = open("/dev/null", O_RDWR, 0);
+            if (fd != -1) {
+                if (dup2(fd, STDIN_FILENO) < 0) throw_stdlib_error("dup stdin");
+                if (dup2(fd, STDOUT_FILENO) < 0) throw_stdlib_error("dup stdout");
+                if (dup2(fd, STDERR_FILENO) < 0) throw_stdlib_error("dup stderr");
+                if (fd > 2 && close(fd) < 0) {
+                    throw_stdlib_error("close fd err");
+                }
+            }
+            umask(027);
+        }
+
+        /**
+         * Container starting process main procedure. Runs in freshly forked (so
+         * single threaded, even if caller is not) child of caller and never returns
+         */
+        [[noreturn]] void container_start_proc(const cont_params& params)
+        {
+            try {
+                const auto& opts = params.opts;
+
+                for (auto fd : params.fds_to_close) {
+                    if (close(fd) < 0) {
+                        throw_stdlib_error("can't cleanup fds in child process");
+                    }
+                }
+
+                // user namespace is created first, others are owned by it
+                if (unshare(container_ns_flags) < 0) {
+                    throw_stdlib_error("can't create container namespaces");
+                }
+
+                if (opts.daemonize) {
+                    daemonize();
+                }
+
+                // finally forking container's init process (in new PID namespace);
+                // init becomes a sibling (CLONE_PARENT), so starting process doesn't linger
+                // waiting for it: init is reaped by caller or, for daemonized container, by host init
+                if (unshare(CLONE_NEWPID) < 0) {
+                    throw_stdlib_error("can't unshare pid ns");
+                }
+                int pipefd[2];
+                if (pipe2(pipefd, O_CLOEXEC) != 0) {
+                    throw_stdlib_error("Can't open pipe to transfer container pid");
+                }
+                pid_t pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, NULL, NULL, 0);
+                if (pid < 0) {
+                    throw_stdlib_error("Can't fork final container init process");
+                } else if (pid > 0) {
+                    write_to_pipe(pipefd[1], pid); // sending container pid to container (as seen from host)
+                    _exit(0);
+                }
+                // final container process continues here
+                pid_t cont_pid = read_from_pipe<pid_t>(pipefd[0]);
+                // session of daemonized container is left by exited daemonizing process;
+                // init leads its own one, as CRIU dumps only trees rooted at session leader
+                if (opts.daemonize && setsid() < 0) {
+                    throw_stdlib_error("Can't make container init session leader");
+                }
+                // sending container pid to host
+                write_to_pipe(params.out_pipe_fd, cont_pid);
+                // wait for host configures user mappings for container
+                read_from_pipe<bool>(params.in_pipe_fd);
+                setup_uts();
+                // mounts are prepared detached while host may still be configuring network
+                auto mounts = prepare_mount_tree(opts.fsimg_path, opts.rootfs_tmpfs);
+                if (!opts.ip.empty()) {
+                    read_from_pipe<bool>(params.in_pipe_fd);
+                    setup_net_cont(params.scripts_path, opts.ip, cont_pid);
+                }
+                // init binary is taken from host, so it must be opened before root is changed
+                int init_fd = -1;
+                if (opts.init) {
+                    string init_path = params.scripts_path + "aucont_pid1";
+                    init_fd = open(init_path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (init_fd < 0) {
+                        throw_stdlib_error("Can't open container init " + init_path);
+                    }
+                }
+                // filesystem configuration must be the very last
+                setup_fs(opts.fsimg_path, mounts);
+
+                // end configuring container
+                write_to_pipe(params.out_pipe_fd, true);
+                // waiting while host does all the stuff needed before command execution
+                read_from_pipe<bool>(params.in_pipe_fd);
+
+                if (close(pipefd[1]) < 0 ||
+                    close(pipefd[0]) < 0 ||
+                    close(params.in_pipe_fd) < 0 ||
+                    close(params.out_pipe_fd) < 0) {
+                    throw_stdlib_error("Error cleaning up file descriptors");
+                }
+                if (params.log_pipe_fd >= 0) {
+                    if (dup2(params.log_pipe_fd, STDOUT_FILENO) < 0 ||
+                        dup2(params.log_pipe_fd, STDERR_FILENO) < 0 ||
+                        close(params.log_pipe_fd) < 0) {
+                        throw_stdlib_error("Can't redirect container output to log");
+                    }
+                }
+                if (params.ready_fd >= 0) {
+                    if (fcntl(params.ready_fd, F_SETFD, 0) < 0 ||
+                        setenv(ready_fd_env, std::to_string(params.ready_fd).c_str(), 1) < 0) {
+                        throw_stdlib_error("Can't pass readiness fd to command");
+                    }
+                }
+                if (params.agent_fd >= 0) {
+                    if (fcntl(params.agent_fd, F_SETFD, 0) < 0 ||
+                        setenv(agent_fd_env, std::to_string(params.agent_fd).c_str(), 1) < 0) {
+                        throw_stdlib_error("Can't pass exec agent socket to init");
+                    }
+                }
+
+                // Running specified command inside container
+                vector<char*> argv;
+                if (init_fd >= 0) {
+                    argv.push_back(const_cast<char*>("aucont_pid1"));
+                }
+                for (const auto& arg : opts.args) {
+                    argv.push_back(const_cast<char*>(arg.c_str()));
+                }
+                argv.push_back(nullptr);
+                if (init_fd >= 0) {
+                    fexecve(init_fd, argv.data(), environ);
+                } else {
+                    execvp(argv[0], argv.data());
+                }
+                throw_stdlib_error("Can't run command in container");
+            } catch (const std::exception& err) {
+                child_fail(err);
+            }
+        }
+
+        void close_fd(int& fd)
+        {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        /**
+         * reads next message of container starting process; it exits (closing
+         * pipe) only if container setup failed
+         */
+        template<typename T>
+        T read_from_container(int fd)
+        {
+            try {
+                return read_from_pipe<T>(fd);
+            } catch (const aucont_error& err) {
+                if (err.code() == EPIPE) {
+                    throw_error("Container setup failed", ECHILD);
+                }
+                throw;
+            }
+        }
+    }
+
+    container_handle start_container(const options& opts, const string& root_dir, const registry& reg)
+    {
+        /**
+         * Setting up IPC for syncronization with container (child)
+         * We need pipe to send stuff to container (name of virtual ethernet device, ...)
+         */
+        int to_cont_pipe_fds[2] = { -1, -1 };
+        int from_cont_pipe_fds[2] = { -1, -1 };
+        // container stdout and stderr go to single pipe (to keep order), drained by log collector
+        int log_pipe_fds[2] = { -1, -1 };
+        // command reports readiness into datagram socket with `notify` probe (see aucont_ready.h)
+        int ready_sock_fds[2] = { -1, -1 };
+        // bound and listening by host, once container pid is known
+        int agent_sock_fd = -1;
+        pid_t starter = -1;
+        container_handle handle;
+        try {
+            if (pipe2(to_cont_pipe_fds, O_CLOEXEC) != 0 ||
+                pipe2(from_cont_pipe_fds, O_CLOEXEC) != 0) {
+                throw_stdlib_error("Can't open pipes for IPC with container");
+            }
+
+            // configuring future container's root
+            setup_fs_host(opts.fsimg_path);
+            if (!opts.prewarm_list.empty()) {
+                start_prewarm(opts.fsimg_path, opts.prewarm_list);
+            }
+
+            if (opts.log && pipe2(log_pipe_fds, O_CLOEXEC) != 0) {
+                throw_stdlib_error("Can't open pipe for container output");
+            }
+            if (opts.ready_probe == "notify" &&
+                socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, ready_sock_fds) != 0) {
+                throw_stdlib_error("Can't open readiness socket");
+            }
+            handle.ready_fd = ready_sock_fds[0];
+            if (opts.exec_agent) {
+                agent_sock_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+                if (agent_sock_fd < 0) {
+                    throw_stdlib_error("Can't create exec agent socket");
+                }
+            }
+            vector<int> fds_to_close = { to_cont_pipe_fds[1], from_cont_pipe_fds[0] };
+            if (opts.log) {
+                fds_to_close.push_back(log_pipe_fds[0]);
+            }
+            if (handle.ready_fd >= 0) {
+                fds_to_close.push_back(handle.ready_fd);
+            }
+
+            cont_params params = { opts, to_cont_pipe_fds[0], from_cont_pipe_fds[1], log_pipe_fds[1],
+                                   ready_sock_fds[1], agent_sock_fd, fds_to_close, root_dir + "/" };
+            // fork + unshare instead of clone: no stack to allocate and fork is safe for threaded caller
+            starter = fork();
+            if (starter < 0) {
+                throw_stdlib_error("Can't run container process");
+            } else if (starter == 0) {
+                container_start_proc(params);
+            }
+            close_fd(to_cont_pipe_fds[0]);
+            close_fd(from_cont_pipe_fds[1]);
+            close_fd(log_pipe_fds[1]);
+            close_fd(ready_sock_fds[1]);
+
+            // waiting for container starting proc to send us container PID
+            handle.pid = read_from_container<pid_t>(from_cont_pipe_fds[0]);
+            // starting proc exits right after init is forked (daemonized one even earlier)
+            waitpid(starter, NULL, 0);
+            starter = -1;
+            handle.child = !opts.daemonize;
+            handle.pidfd = open_pidfd(handle.pid);
+            if (handle.pidfd < 0) {
+                throw_stdlib_error("Can't open pidfd of container");
+            }
+
+            if (opts.log) {
+                // output, written before collector starts, waits in pipe
+                start_log_collector(log_pipe_fds[0], get_log_path(root_dir, handle.pid), opts.log_size);
+                close_fd(log_pipe_fds[0]);
+            }
+
+            // setting up user
+            setup_user_in_container(handle.pid);
+            write_to_pipe(to_cont_pipe_fds[1], true); // synch
+
+            // setting up networking if needed (host part)
+            if (!opts.ip.empty()) {
+                setup_net_host(root_dir + "/", opts.ip, handle.pid);
+                if (opts.net_rate > 0) {
+                    setup_net_shaping(root_dir + "/", opts, handle.pid, get_cont_veth_name(handle.pid));
+                }
+                if (!opts.ports.empty() || opts.net_prio != "normal") {
+                    setup_net_rules(root_dir + "/", opts, handle.pid);
+                }
+                // syncronizing with container; now container can setup it's network side
+                write_to_pipe(to_cont_pipe_fds[1], true);
+            }
+            container_t cont(handle.pid, opts.cpu_perc);
+            if (opts.cpu_max > 0) {
+                cont.cpu_perc = std::min(std::max(opts.cpu_perc, opts.cpu_min), opts.cpu_max);
+                cont.cpu_min = opts.cpu_min;
+                cont.cpu_max = opts.cpu_max;
+            }
+            cont.mem_min = opts.mem_min;
+            cont.mem_max = opts.mem_max;
+            cont.readiness = opts.ready_probe.empty() ? readiness_untracked : readiness_starting;
+            setup_cont_limits(root_dir, cont, opts.pressure_events);
+
+            if (agent_sock_fd >= 0) {
+                // socket is shared with init, which accepts connections once command is started
+                listen_agent_socket(agent_sock_fd, root_dir, handle.pid);
+                close_fd(agent_sock_fd);
+            }
+
+            // waiting for container to be configured
+            read_from_container<bool>(from_cont_pipe_fds[0]);
+            close_fd(from_cont_pipe_fds[0]);
+
+            // container may be checkpointed from now on
+            save_spec(get_spec_path(root_dir, handle.pid),
+                      { opts, opts.ip.empty() ? "" : get_cont_veth_name(handle.pid) });
+
+            if (!reg.add_container(cont)) {
+                throw_error("Container with pid: " + std::to_string(handle.pid) + " is already running", EEXIST);
+            }
+
+            // container can proceed to command execution
+            write_to_pipe(to_cont_pipe_fds[1], true);
+            close_fd(to_cont_pipe_fds[1]);
+        } catch (...) {
+            // container init gets EOF from closed pipe and exits on its own
+            for (int* fd : { &to_cont_pipe_fds[0], &to_cont_pipe_fds[1], &from_cont_pipe_fds[0],
+                             &from_cont_pipe_fds[1], &log_pipe_fds[0], &log_pipe_fds[1], &ready_sock_fds[1],
+                             &handle.ready_fd, &agent_sock_fd }) {
+                close_fd(*fd);
+            }
+            if (starter > 0) {
+                waitpid(starter, NULL, 0);
+            }
+            if (handle.child) {
+                waitpid(handle.pid, NULL, 0);
+            }
+            if (handle.pid > 0) {
+                // its cgroups may be already created, but it never gets to registry
+                struct pollfd pfd = { handle.pidfd, POLLIN, 0 };
+                if (handle.child || (pfd.fd >= 0 && poll(&pfd, 1, failed_exit_timeout_ms) > 0)) {
+                    container_t cont(handle.pid);
+                    cont.cpu_max = opts.cpu_max;
+                    release_containers(root_dir, { cont });
+                }
+            }
+            close_fd(handle.pidfd);
+            throw;
+        }
+        return handle;
+    }
+
+    container_handle restore_container(const string& snapshot_name, const string& root_dir, const registry& reg)
+    {
+        auto snapshot = load_snapshot(root_dir, snapshot_name);
+        const auto& opts = snapshot.spec.opts;
+        if (!opts.ip.empty()) {
+            // snapshot of container, which was left running, or one restored twice
+            for (const auto& running : reg.get_containers()) {
+                const string spec_path = get_spec_path(root_dir, running.pid);
+                if (access(spec_path.c_str(), F_OK) == 0 && load_spec(spec_path).opts.ip == opts.ip) {
+                    throw_error("Container " + std::to_string(running.pid) + " already has ip " + opts.ip, EADDRINUSE);
+                }
+            }
+        }
+
+        int log_pipe_fds[2] = { -1, -1 };
+        container_handle handle;
+        container_t cont = snapshot.cont;
+        std::set<pid_t> procs;
+        try {
+            if (opts.log && pipe2(log_pipe_fds, O_CLOEXEC) != 0) {
+                throw_stdlib_error("Can't open pipe for container output");
+            }
+            // CRIU, run with sudo, opens write end of pipe by its /proc path
+            const string output = !opts.log ? "/dev/null" :
+                "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(log_pipe_fds[1]);
+            string inherits;
+            for (int fd = 0; fd < 3; ++fd) {
+                const string& key = snapshot.stdio[fd];
+                if (!key.empty() && inherits.find(":" + key + " ") == string::npos) {
+                    inherits += "fd[" + std::to_string(fd) + "]:" + key + " ";
+                }
+            }
+            // names are per thread, as runtime may restore from several threads at once
+            const string tid = std::to_string(syscall(SYS_gettid));
+            const string tmp_veth = "aurst_" + tid;
+            const string pidfile = snapshot.path + "/restore." + tid + ".pid";
+            unlink(pidfile.c_str()); // CRIU doesn't overwrite it
+            // keys look like glob patterns, so their list goes quoted (not last)
+            if (sysrun(root_dir + "/restore_cont.sh", snapshot.path + "/images", opts.fsimg_path, pidfile,
+                       opts.ip.empty() ? "" : snapshot.spec.cont_veth + "=" + tmp_veth, inherits, output) != 0) {
+                throw_error("Can't restore container from " + snapshot.path + " (see CRIU log in its images)");
+            }
+            close_fd(log_pipe_fds[1]);
+            std::ifstream(pidfile) >> handle.pid;
+            unlink(pidfile.c_str());
+            if (handle.pid <= 0) {
+                throw_error("CRIU didn't report pid of restored container");
+            }
+            cont.pid = handle.pid;
+            handle.pidfd = open_pidfd(handle.pid);
+            if (handle.pidfd < 0) {
+                throw_stdlib_error("Can't open pidfd of container");
+            }
+            // all of them are stopped until host side is ready
+            procs = get_container_procs(handle.pid);
+
+            if (opts.log) {
+                start_log_collector(log_pipe_fds[0], get_log_path(root_dir, handle.pid), opts.log_size);
+                close_fd(log_pipe_fds[0]);
+            }
+            if (!opts.ip.empty()) {
+                // addresses and routes inside container are restored by CRIU
+                if (sysrun(root_dir + "/restore_net_host.sh", tmp_veth, get_host_veth_name(handle.pid),
+                           get_host_ip(opts.ip)) != 0) {
+                    throw_error("Can't setup networking (from host)");
+                }
+                if (opts.net_rate > 0) {
+                    setup_net_shaping(root_dir + "/", opts, handle.pid, snapshot.spec.cont_veth);
+                }
+                if (!opts.ports.empty() || opts.net_prio != "normal") {
+                    setup_net_rules(root_dir + "/", opts, handle.pid);
+                }
+            }
+            setup_cont_limits(root_dir, cont, opts.pressure_events, procs);
+
+            cont.paused = false;
+            if (cont.readiness != readiness_ready) {
+                // probe isn't restored, workload reports readiness to nobody
+                cont.readiness = readiness_untracked;
+            }
+            save_spec(get_spec_path(root_dir, handle.pid), snapshot.spec);
+            if (!reg.add_container(cont)) {
+                throw_error("Container with pid: " + std::to_string(handle.pid) + " is already running", EEXIST);
+            }
+            for (auto proc : procs) {
+                kill(proc, SIGCONT);
+            }
+        } catch (...) {
+            for (int* fd : { &log_pipe_fds[0], &log_pipe_fds[1] }) {
+                close_fd(*fd);
+            }
+            if (handle.pid > 0) {
+                // stopped processes die with init, as with any pid namespace
+                kill(handle.pid, SIGKILL);
+                struct pollfd pfd = { handle.pidfd, POLLIN, 0 };
+                if (pfd.fd >= 0 && poll(&pfd, 1, failed_exit_timeout_ms) > 0) {
+                    release_containers(root_dir, { cont });
+                }
+            }
+            close_fd(handle.pidfd);
+            throw;
+        }
+        return handle;
+    }
+
+    void release_containers(const string& root_dir, const vector<container_t>& conts)
+    {
+        string privileged_dirs;
+        for (const auto& cont : conts) {
+            vector<string> dirs = {
+                get_cont_cgroup2_dir(root_dir, cont.pid),
+                get_freezer_path(root_dir) + "/cont_" + std::to_string(cont.pid)
+            };
+            if (cont.cpu_max > 0) {
+                // others share cgroup of their cpu percentage
+                dirs.push_back(get_cpu_cgroup_path(root_dir) + "/" + get_cont_cpu_cgroup(cont));
+            }
+            for (const auto& dir : dirs) {
+                // hierarchy roots belong to root, their subdirs are removed by script then
+                if (rmdir(dir.c_str()) != 0 && (errno == EACCES || errno == EPERM)) {
+                    privileged_dirs += dir + " ";
+                }
+            }
+            unlink(get_agent_sock_path(root_dir, cont.pid).c_str());
+            unlink(get_spec_path(root_dir, cont.pid).c_str());
+        }
+        if (!privileged_dirs.empty()) {
+            // best effort: dirs left here are reported by test/scripts/bench_scale.py;
+            // dir list is the last (not quoted) argument, so shell splits it
+            sysrun(root_dir + "/remove_cont_cgroups.sh", privileged_dirs);
+        }
+    }
+}
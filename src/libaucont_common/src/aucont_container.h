@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "aucont_runtime.h"
+#include "aucont_registry.h"
+
+namespace aucont
+{
+    /**
+     * Starts container and registers it in registry (see `Runtime::start`).
+     * Throws aucont_error on failure
+     * @param root_dir aucont root dir with helper scripts
+     */
+    container_handle start_container(const options& opts, const std::string& root_dir, const registry& reg);
+
+    /**
+     * Restores container from snapshot (see aucont_checkpoint.h), recreates its
+     * host side (veth end, shaping, published ports, cgroups, log collector) and
+     * registers it (see `Runtime::restore`). Throws aucont_error on failure
+     * @param snapshot snapshot path or name
+     */
+    container_handle restore_container(const std::string& snapshot, const std::string& root_dir, const registry& reg);
+
+    /**
+     * Releases host objects, which outlive processes of exited containers:
+     * their own cgroup dirs (v2, freezer and adaptive v1 cpu one), spec (see
+     * aucont_spec.h) and exec agent socket. Dirs, which can't be removed by
+     * caller, are removed with helper script. Missing objects are skipped, so
+     * it's safe to repeat
+     * @param root_dir aucont root dir with helper scripts
+     */
+    void release_containers(const std::string& root_dir, const std::vector<container_t>& conts);
+}
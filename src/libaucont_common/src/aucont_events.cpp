@@ -0,0 +1,568 @@
+#include "aucont_events.h"
+#include "aucont_cgroup.h"
+#include "aucont_common.h"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+namespace aucont
+{
+    using std::string;
+    using std::vector;
+
+    namespace
+    {
+        /**
+         * First version of `struct pidfd_info` (PIDFD_GET_INFO ioctl, Linux >= 6.15),
+         * declared here as system headers may not have it yet
+         */
+        struct pidfd_exit_info
+        {
+            uint64_t mask;
+            uint64_t cgroupid;
+            uint32_t pid, tgid, ppid, ruid, rgid, euid, egid, suid, sgid, fsuid, fsgid;
+            int32_t exit_code;
+        };
+
+        const uint64_t pidfd_info_exit = 1 << 3;
+        const unsigned long pidfd_get_info = _IOWR(0xFF, 11, pidfd_exit_info);
+
+        // exit status is available only after init is reaped (by host init for daemonized container)
+        const int64_t reap_wait_ms = 100;
+
+        // 200 ms of stall in 2 s window (smallest window allowed to unprivileged users)
+        const char cpu_psi_trigger[] = "some 200000 2000000";
+
+        const size_t max_exec_event_size = 64 * 1024;
+
+        enum event_source: uint32_t
+        {
+            inotify_source,
+            exec_source,
+            pidfd_source,
+            psi_source
+        };
+
+        string get_events_dir(const string& root_dir)
+        {
+            return root_dir + "/events";
+        }
+
+        int64_t realtime_ms()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+        }
+
+        string json_string(const string& str)
+        {
+            string result = "\"";
+            for (char c : str) {
+                if (c == '"' || c == '\\') {
+                    result += '\\';
+                    result += c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    result += buf;
+                } else {
+                    result += c;
+                }
+            }
+            return result + "\"";
+        }
+
+        /**
+         * @param fields additional fields of event, each starts with comma
+         */
+        event_t make_event(const char* event, pid_t pid, const string& fields = "")
+        {
+            std::stringstream json;
+            json << "{\"time\":" << realtime_ms() << ",\"event\":\"" << event << "\",\"pid\":" << pid << fields << "}";
+            return { pid, json.str() };
+        }
+
+        /**
+         * returns total time (in microseconds) when some of container processes waited for cpu
+         */
+        uint64_t read_cpu_stall_us(int psi_fd)
+        {
+            char buf[256];
+            ssize_t len = pread(psi_fd, buf, sizeof(buf) - 1, 0);
+            if (len <= 0) {
+                return 0;
+            }
+            buf[len] = '\0';
+            const char* total = strstr(buf, "total=");
+            return total == nullptr ? 0 : std::stoull(total + strlen("total="));
+        }
+
+        uint64_t read_throttled_us(const string& cg_dir)
+        {
+            return read_cgroup_stat(cg_dir + "/cpu.stat")["throttled_usec"];
+        }
+
+        /**
+         * @return 1 if exit status is known, 0 if process is not reaped yet,
+         *         -1 if kernel can't report it
+         */
+        int get_exit_status(int pidfd, int& status)
+        {
+            pidfd_exit_info info;
+            memset(&info, 0, sizeof(info));
+            info.mask = pidfd_info_exit;
+            if (ioctl(pidfd, pidfd_get_info, &info) < 0) {
+                return -1;
+            }
+            if ((info.mask & pidfd_info_exit) == 0) {
+                return 0;
+            }
+            status = info.exit_code;
+            return 1;
+        }
+
+        void add_source(int epoll_fd, int fd, uint32_t events, event_source source, pid_t pid)
+        {
+            struct epoll_event ev;
+            ev.events = events;
+            ev.data.u64 = (static_cast<uint64_t>(source) << 32) | static_cast<uint32_t>(pid);
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                throw_stdlib_error("Can't add event source to epoll");
+            }
+        }
+
+        bool make_sock_addr(const string& path, struct sockaddr_un& addr)
+        {
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.length() >= sizeof(addr.sun_path)) {
+                return false;
+            }
+            strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            return true;
+        }
+    }
+
+    void publish_exec_event(const string& root_dir, pid_t cont_pid, const vector<string>& args)
+    {
+        const string events_dir = get_events_dir(root_dir);
+        DIR* dir = opendir(events_dir.c_str());
+        if (dir == nullptr) {
+            return; // nobody has ever watched events
+        }
+        int sock_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (sock_fd < 0) {
+            closedir(dir);
+            return;
+        }
+        string args_json = "[";
+        for (size_t i = 0; i < args.size(); ++i) {
+            args_json += (i == 0 ? "" : ",") + json_string(args[i]);
+        }
+        auto event = make_event("exec", cont_pid, ",\"args\":" + args_json + "]");
+        // message is container pid followed by JSON
+        string msg(reinterpret_cast<const char*>(&cont_pid), sizeof(cont_pid));
+        msg += event.json;
+
+        while (struct dirent* entry = readdir(dir)) {
+            string name = entry->d_name;
+            if (name.length() < 5 || name.compare(name.length() - 5, 5, ".sock") != 0) {
+                continue;
+            }
+            string path = events_dir + "/" + name;
+            struct sockaddr_un addr;
+            if (!make_sock_addr(path, addr)) {
+                continue;
+            }
+            if (sendto(sock_fd, msg.data(), msg.size(), MSG_DONTWAIT,
+                       reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 && errno == ECONNREFUSED) {
+                unlink(path.c_str()); // monitor was killed without cleanup
+            }
+        }
+        close(sock_fd);
+        closedir(dir);
+    }
+
+    event_monitor::event_monitor(const string& root_dir)
+    : root_dir(root_dir), reg(root_dir), epoll_fd(-1), inotify_fd(-1), registry_wd(-1), sock_fd(-1)
+    {
+        static std::atomic<unsigned> monitors_count(0);
+        try {
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd < 0) {
+                throw_stdlib_error("Can't create epoll instance");
+            }
+
+            // registry file is rewritten in place on every change
+            inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotify_fd < 0) {
+                throw_stdlib_error("Can't create inotify instance");
+            }
+            registry_wd = inotify_add_watch(inotify_fd, root_dir.c_str(), IN_CLOSE_WRITE);
+            if (registry_wd < 0) {
+                throw_stdlib_error("Can't watch directory [ " + root_dir + " ]");
+            }
+            add_source(epoll_fd, inotify_fd, EPOLLIN, inotify_source, 0);
+
+            const string events_dir = get_events_dir(root_dir);
+            if (mkdir(events_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+                throw_stdlib_error("Can't create directory [ " + events_dir + " ]");
+            }
+            sock_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (sock_fd < 0) {
+                throw_stdlib_error("Can't create exec events socket");
+            }
+            auto path = events_dir + "/" + std::to_string(getpid()) + "_" + std::to_string(monitors_count++) + ".sock";
+            struct sockaddr_un addr;
+            if (!make_sock_addr(path, addr)) {
+                throw_error("Path of exec events socket is too long: " + path, ENAMETOOLONG);
+            }
+            unlink(path.c_str());
+            if (bind(sock_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+                throw_stdlib_error("Can't bind exec events socket " + path);
+            }
+            sock_path = path;
+            add_source(epoll_fd, sock_fd, EPOLLIN, exec_source, 0);
+
+            read_registry(pending, "running");
+        } catch (...) {
+            close_all();
+            throw;
+        }
+    }
+
+    event_monitor::~event_monitor()
+    {
+        close_all();
+    }
+
+    void event_monitor::close_all()
+    {
+        while (!conts.empty()) {
+            unwatch(conts.begin()->first);
+        }
+        if (sock_fd >= 0) {
+            close(sock_fd);
+        }
+        if (!sock_path.empty()) {
+            unlink(sock_path.c_str());
+        }
+        if (inotify_fd >= 0) {
+            close(inotify_fd);
+        }
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+        }
+    }
+
+    void event_monitor::poll(vector<event_t>& events, int timeout_ms)
+    {
+        if (!pending.empty()) {
+            events.insert(events.end(), pending.begin(), pending.end());
+            pending.clear();
+            return;
+        }
+        int wait_ms = timeout_ms;
+        auto now = monotonic_ms();
+        for (const auto& cont : conts) {
+            if (cont.second.reap_deadline > 0) {
+                int left = cont.second.reap_deadline > now ? static_cast<int>(cont.second.reap_deadline - now) : 0;
+                wait_ms = wait_ms < 0 || left < wait_ms ? left : wait_ms;
+            }
+        }
+
+        const int max_events = 64;
+        struct epoll_event ready_events[max_events];
+        int ready = epoll_wait(epoll_fd, ready_events, max_events, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                return;
+            }
+            throw_stdlib_error("epoll_wait failed");
+        }
+        for (int i = 0; i < ready; ++i) {
+            auto source = static_cast<event_source>(ready_events[i].data.u64 >> 32);
+            auto pid = static_cast<pid_t>(ready_events[i].data.u64 & 0xffffffff);
+            if (source == inotify_source) {
+                read_inotify(events);
+            } else if (source == exec_source) {
+                read_exec_events(events);
+            } else if (conts.count(pid) == 0) {
+                continue; // container exit is already reported
+            } else if (source == pidfd_source) {
+                on_pidfd(pid, ready_events[i].events, events);
+            } else if (source == psi_source) {
+                on_cpu_pressure(pid, ready_events[i].events, events);
+            }
+        }
+
+        // exit codes of containers, which are not reaped in time, are unknown
+        now = monotonic_ms();
+        vector<pid_t> expired;
+        for (const auto& cont : conts) {
+            if (cont.second.reap_deadline > 0 && cont.second.reap_deadline <= now) {
+                expired.push_back(cont.first);
+            }
+        }
+        for (auto pid : expired) {
+            report_exit(pid, events);
+        }
+    }
+
+    void event_monitor::read_registry(vector<event_t>& events, const char* new_event)
+    {
+        auto running = reg.get_containers();
+        for (auto it = exited.begin(); it != exited.end();) {
+            it = running.count(container_t(*it)) == 0 ? exited.erase(it) : std::next(it);
+        }
+        for (const auto& cont : running) {
+            if (exited.count(cont.pid) != 0) {
+                continue;
+            }
+            auto it = conts.find(cont.pid);
+            if (it == conts.end()) {
+                watch(cont, events, new_event);
+            } else {
+                if (it->second.paused != cont.paused) {
+                    it->second.paused = cont.paused;
+                    events.push_back(make_event(cont.paused ? "freeze" : "thaw", cont.pid));
+                }
+                if (it->second.readiness != cont.readiness) {
+                    it->second.readiness = cont.readiness;
+                    report_readiness(cont, events);
+                }
+            }
+        }
+    }
+
+    void event_monitor::watch(const container_t& cont, vector<event_t>& events, const char* event)
+    {
+        std::stringstream fields;
+        fields << ",\"cpu\":" << static_cast<int>(cont.cpu_perc) << ",\"paused\":" << (cont.paused ? "true" : "false");
+        int pidfd = open_pidfd(cont.pid);
+        if (pidfd < 0) {
+            if (errno != ESRCH) {
+                throw_stdlib_error("Can't open pidfd for container " + std::to_string(cont.pid));
+            }
+            // exited and reaped before it could be watched, so its exit code is unknown
+            events.push_back(make_event(event, cont.pid, fields.str()));
+            exited.insert(cont.pid);
+            events.push_back(make_event("exit", cont.pid, ",\"code\":null"));
+            return;
+        }
+        auto& watched = conts[cont.pid];
+        watched.pidfd = pidfd;
+        watched.cpu_psi_fd = -1;
+        watched.memory_wd = -1;
+        watched.paused = cont.paused;
+        watched.readiness = cont.readiness;
+        watched.reap_deadline = 0;
+        watched.stall_us = 0;
+        watched.throttled_us = 0;
+        add_source(epoll_fd, pidfd, EPOLLIN, pidfd_source, cont.pid);
+
+        // PSI trigger belongs to open file, so every monitor has its own one;
+        // monitor only reads host state: container without its own cgroup v2
+        // (see `pressure_events` option) has no pressure and memory events
+        const string cg_dir = get_cont_cgroup2_dir(root_dir, cont.pid);
+        int psi_fd = open((cg_dir + "/cpu.pressure").c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (psi_fd >= 0 && write(psi_fd, cpu_psi_trigger, strlen(cpu_psi_trigger) + 1) < 0) {
+            close(psi_fd);
+            psi_fd = -1;
+        }
+        if (psi_fd >= 0) {
+            watched.cpu_psi_fd = psi_fd;
+            watched.stall_us = read_cpu_stall_us(psi_fd);
+            watched.throttled_us = read_throttled_us(cg_dir);
+            add_source(epoll_fd, psi_fd, EPOLLPRI, psi_source, cont.pid);
+        }
+
+        // kernel notifies about modification of cgroup event files
+        watched.memory_wd = inotify_add_watch(inotify_fd, (cg_dir + "/memory.events").c_str(), IN_MODIFY);
+        if (watched.memory_wd >= 0) {
+            watch_owners[watched.memory_wd] = cont.pid;
+            watched.memory_events = read_cgroup_stat(cg_dir + "/memory.events");
+        }
+
+        events.push_back(make_event(event, cont.pid, fields.str()));
+    }
+
+    void event_monitor::report_readiness(const container_t& cont, vector<event_t>& events)
+    {
+        if (cont.readiness == readiness_ready) {
+            events.push_back(make_event("ready", cont.pid, ",\"ready\":true"));
+        } else if (cont.readiness == readiness_failed) {
+            events.push_back(make_event("ready", cont.pid, ",\"ready\":false"));
+        }
+    }
+
+    void event_monitor::unwatch(pid_t pid)
+    {
+        auto it = conts.find(pid);
+        if (it == conts.end()) {
+            return;
+        }
+        // closing fds removes them from epoll set
+        close(it->second.pidfd);
+        if (it->second.cpu_psi_fd >= 0) {
+            close(it->second.cpu_psi_fd);
+        }
+        if (it->second.memory_wd >= 0) {
+            inotify_rm_watch(inotify_fd, it->second.memory_wd);
+            watch_owners.erase(it->second.memory_wd);
+        }
+        conts.erase(it);
+    }
+
+    void event_monitor::read_inotify(vector<event_t>& events)
+    {
+        alignas(struct inotify_event) char buf[4096];
+        bool registry_changed = false;
+        while (true) {
+            ssize_t len = read(inotify_fd, buf, sizeof(buf));
+            if (len < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN) {
+                    break;
+                }
+                throw_stdlib_error("Can't read inotify events");
+            }
+            for (ssize_t offset = 0; offset < len;) {
+                auto event = reinterpret_cast<const struct inotify_event*>(buf + offset);
+                offset += sizeof(struct inotify_event) + event->len;
+                if (event->wd == registry_wd) {
+                    registry_changed |= event->len > 0 && strcmp(event->name, "containers") == 0;
+                    continue;
+                }
+                auto owner = watch_owners.find(event->wd);
+                if (owner == watch_owners.end()) {
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    // cgroup is removed
+                    conts[owner->second].memory_wd = -1;
+                    watch_owners.erase(owner);
+                } else {
+                    on_memory_events(owner->second, events);
+                }
+            }
+        }
+        if (registry_changed) {
+            read_registry(events, "start");
+        }
+    }
+
+    void event_monitor::read_exec_events(vector<event_t>& events)
+    {
+        vector<char> buf(max_exec_event_size);
+        while (true) {
+            ssize_t len = recv(sock_fd, buf.data(), buf.size(), MSG_TRUNC);
+            if (len < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN) {
+                    break;
+                }
+                throw_stdlib_error("Can't read exec events");
+            }
+            if (static_cast<size_t>(len) <= sizeof(pid_t) || static_cast<size_t>(len) > buf.size()) {
+                continue; // truncated or broken message
+            }
+            pid_t pid;
+            memcpy(&pid, buf.data(), sizeof(pid));
+            events.push_back({ pid, string(buf.data() + sizeof(pid), len - sizeof(pid)) });
+        }
+    }
+
+    void event_monitor::on_pidfd(pid_t pid, uint32_t revents, vector<event_t>& events)
+    {
+        auto& cont = conts[pid];
+        int status;
+        if ((revents & EPOLLHUP) == 0 && cont.reap_deadline == 0 && get_exit_status(cont.pidfd, status) == 0) {
+            // exited, but not reaped yet: pidfd reports EPOLLHUP (always polled) after reaping
+            cont.reap_deadline = monotonic_ms() + reap_wait_ms;
+            struct epoll_event ev;
+            ev.events = 0;
+            ev.data.u64 = (static_cast<uint64_t>(pidfd_source) << 32) | static_cast<uint32_t>(pid);
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, cont.pidfd, &ev) < 0) {
+                throw_stdlib_error("Can't wait for container to be reaped");
+            }
+            return;
+        }
+        report_exit(pid, events);
+    }
+
+    void event_monitor::report_exit(pid_t pid, vector<event_t>& events)
+    {
+        int status = 0;
+        std::stringstream fields;
+        if (get_exit_status(conts[pid].pidfd, status) != 1) {
+            fields << ",\"code\":null";
+        } else if (WIFSIGNALED(status)) {
+            fields << ",\"code\":" << 128 + WTERMSIG(status) << ",\"signal\":" << WTERMSIG(status);
+        } else {
+            fields << ",\"code\":" << WEXITSTATUS(status);
+        }
+        unwatch(pid);
+        exited.insert(pid);
+        events.push_back(make_event("exit", pid, fields.str()));
+    }
+
+    void event_monitor::on_memory_events(pid_t pid, vector<event_t>& events)
+    {
+        auto& cont = conts[pid];
+        auto current = read_cgroup_stat(get_cont_cgroup2_dir(root_dir, pid) + "/memory.events");
+        auto& previous = cont.memory_events;
+        auto oom = current["oom"] - previous["oom"];
+        auto oom_kill = current["oom_kill"] - previous["oom_kill"];
+        auto high = current["high"] - previous["high"];
+        if (oom > 0 || oom_kill > 0) {
+            events.push_back(make_event("oom", pid, ",\"oom\":" + std::to_string(oom) +
+                                                    ",\"oom_kill\":" + std::to_string(oom_kill)));
+        }
+        if (high > 0) {
+            events.push_back(make_event("throttle", pid, ",\"resource\":\"memory\",\"high\":" + std::to_string(high)));
+        }
+        previous = current;
+    }
+
+    void event_monitor::on_cpu_pressure(pid_t pid, uint32_t revents, vector<event_t>& events)
+    {
+        auto& cont = conts[pid];
+        if (revents & EPOLLERR) {
+            // cgroup is removed, trigger won't fire anymore
+            close(cont.cpu_psi_fd);
+            cont.cpu_psi_fd = -1;
+            return;
+        }
+        auto stall_us = read_cpu_stall_us(cont.cpu_psi_fd);
+        auto throttled_us = read_throttled_us(get_cont_cgroup2_dir(root_dir, pid));
+        std::stringstream fields;
+        fields << ",\"resource\":\"cpu\",\"stall_us\":" << stall_us - cont.stall_us
+               << ",\"throttled_us\":" << throttled_us - cont.throttled_us;
+        cont.stall_us = stall_us;
+        cont.throttled_us = throttled_us;
+        events.push_back(make_event("throttle", pid, fields.str()));
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include "aucont_registry.h"
+
+namespace aucont
+{
+    /**
+     * Sends exec event to every event_monitor of root dir (through datagram
+     * sockets in `root_dir/events`); never blocks and never fails
+     */
+    void publish_exec_event(const std::string& root_dir, pid_t cont_pid, const std::vector<std::string>& args);
+
+    struct event_t
+    {
+        pid_t pid;        // container the event is about
+        std::string json; // event as one line JSON object
+    };
+
+    /**
+     * Push based stream of container events, one JSON object per event:
+     *   {"time":UNIX_MS,"event":TYPE,"pid":CONTAINER_PID,...}
+     * TYPE is one of
+     *   running  - container was running when monitor was created
+     *   start    - container was added to registry
+     *   exec     - command was run in container ("args")
+     *   exit     - container init exited ("code", and "signal" for killed one; code
+     *              is null if it is unknown: kernel < 6.15, init is not reaped in time
+     *              or is reaped before monitor saw container, which is then
+     *              reported with start (or running) and exit at once)
+     *   freeze, thaw - container was paused / resumed
+     *   ready    - readiness of container workload was awaited (see aucont_ready.h):
+     *              "ready" is true or false if it wasn't ready in time or exited before it
+     *   oom      - processes of container were killed by OOM killer ("oom_kill")
+     *   throttle - container was stalled on "cpu" (stalled time in "stall_us", cpu.max
+     *              throttled time in "throttled_us") or throttled above memory.high ("high")
+     * Nothing is polled: container exits come from pidfds, registry changes and
+     * cgroup v2 `memory.events` from inotify, cpu stalls from PSI trigger (cgroup
+     * v2 events are reported only for containers, which have their own cgroup v2:
+     * ones with adaptive limits or `pressure_events` option) and exec events from
+     * aucont tools through datagram socket.
+     * Monitor is not thread safe, but several monitors may be used at once
+     */
+    class event_monitor
+    {
+    public:
+        explicit event_monitor(const std::string& root_dir);
+        ~event_monitor();
+
+        event_monitor(const event_monitor&) = delete;
+        event_monitor& operator=(const event_monitor&) = delete;
+
+        /**
+         * Waits for events at most `timeout_ms` (-1 to wait forever) and appends
+         * them to `events`. Throws aucont_error on failure
+         */
+        void poll(std::vector<event_t>& events, int timeout_ms);
+
+    private:
+        struct watched_container
+        {
+            int pidfd;
+            int cpu_psi_fd;        // -1 if there is no PSI trigger for container
+            int memory_wd;         // inotify watch of memory.events or -1
+            bool paused;
+            uint8_t readiness;
+            int64_t reap_deadline; // > 0 while exit code is awaited
+            uint64_t stall_us;
+            uint64_t throttled_us;
+            std::map<std::string, uint64_t> memory_events;
+        };
+
+        void read_registry(std::vector<event_t>& events, const char* new_event);
+        void watch(const container_t& cont, std::vector<event_t>& events, const char* event);
+        void report_readiness(const container_t& cont, std::vector<event_t>& events);
+        void unwatch(pid_t pid);
+        void read_inotify(std::vector<event_t>& events);
+        void read_exec_events(std::vector<event_t>& events);
+        void on_pidfd(pid_t pid, uint32_t revents, std::vector<event_t>& events);
+        void report_exit(pid_t pid, std::vector<event_t>& events);
+        void on_memory_events(pid_t pid, std::vector<event_t>& events);
+        void on_cpu_pressure(pid_t pid, uint32_t revents, std::vector<event_t>& events);
+        void close_all();
+
+        std::string root_dir;
+        registry reg;
+        int epoll_fd;
+        int inotify_fd;
+        int registry_wd;
+        int sock_fd;
+        std::string sock_path;
+        std::map<pid_t, watched_container> conts;
+        std::set<pid_t> exited;            // exited, but maybe still in registry
+        std::map<int, pid_t> watch_owners; // inotify watch -> container
+        std::vector<event_t> pending;      // `running` events, returned by first poll
+    };
+}
@@ -0,0 +1,126 @@
+#include "aucont_exec.h"
+#include "aucont_cgroup.h"
+
+#include <fstream>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+namespace aucont
+{
+    namespace
+    {
+        void unshare_ns(std::string ns, std::string pid_str)
+        {
+            auto f = "/proc/" + pid_str + "/ns/" + ns;
+            int fd = open(f.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw_stdlib_error("Can't open ns fd [ " + f + " ]");
+            }
+            if (setns(fd, 0) < 0) {
+                close(fd);
+                throw_stdlib_error("Can't set ns: " + ns);
+            }
+            close(fd);
+        }
+    }
+
+    pid_t spawn_in_container(const container_t& cont, const std::string& root_dir,
+                             const std::vector<std::string>& args, const exec_options& exec_opts)
+    {
+        if (args.empty()) {
+            throw_error("No command specified to run inside container");
+        }
+        std::vector<char*> argv;
+        for (const auto& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        auto cg_tasks_file = get_cpu_cgroup_path(root_dir) + "/" + get_cont_cpu_cgroup(cont) + "/tasks";
+        auto cg2_procs_file = get_cont_cgroup2_dir(root_dir, cont.pid) + "/cgroup.procs";
+
+        pid_t helper_pid = fork();
+        if (helper_pid < 0) {
+            throw_stdlib_error("Fork failed");
+        } else if (helper_pid > 0) {
+            if (exec_opts.new_pgroup) {
+                setpgid(helper_pid, helper_pid); // avoid race with child's own setpgid
+            }
+            return helper_pid;
+        }
+
+        try {
+            if (exec_opts.new_pgroup) {
+                setpgid(0, 0);
+            }
+            const int redirects[][2] = {
+                { exec_opts.stdin_fd, STDIN_FILENO },
+                { exec_opts.stdout_fd, STDOUT_FILENO },
+                { exec_opts.stderr_fd, STDERR_FILENO },
+            };
+            for (const auto& redirect : redirects) {
+                if (redirect[0] >= 0 && dup2(redirect[0], redirect[1]) < 0) {
+                    throw_stdlib_error("Can't redirect command stdio");
+                }
+            }
+
+            std::string cont_pid_str = std::to_string(cont.pid);
+
+            int synch_pipe[2];
+            if (pipe2(synch_pipe, O_CLOEXEC) < 0) {
+                throw_stdlib_error("pipe");
+            }
+
+            // applying user and pid namespace and forking first
+            // unsharing user first because it sets proper permissions for next unshare
+            unshare_ns("user", cont_pid_str);
+            unshare_ns("pid", cont_pid_str);
+
+            auto cmd_pid = fork();
+            if (cmd_pid < 0) {
+                throw_stdlib_error("Fork failed");
+            } else if (cmd_pid > 0) {
+                close(synch_pipe[0]);
+
+                // setting up cgroup if needed
+                if (cont.cpu_perc != 100 || cont.cpu_max > 0) {
+                    std::ofstream out(cg_tasks_file, std::ios_base::out | std::ios_base::app);
+                    out << cmd_pid;
+                    out.close();
+                }
+                if (access(cg2_procs_file.c_str(), W_OK) == 0) {
+                    std::ofstream out(cg2_procs_file, std::ios_base::out | std::ios_base::app);
+                    out << cmd_pid;
+                    out.close();
+                }
+                write_to_pipe(synch_pipe[1], true);
+                close(synch_pipe[1]);
+
+                int status = 0;
+                if (waitpid(cmd_pid, &status, 0) < 0) {
+                    throw_stdlib_error("Waitpid failed");
+                }
+                _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+            }
+            close(synch_pipe[1]);
+
+            unshare_ns("net", cont_pid_str);
+            unshare_ns("ipc", cont_pid_str);
+            unshare_ns("uts", cont_pid_str);
+            unshare_ns("mnt", cont_pid_str);
+
+            // waiting for cgroup to be configured
+            read_from_pipe<bool>(synch_pipe[0]);
+            close(synch_pipe[0]);
+
+            execvp(argv[0], argv.data());
+            throw_stdlib_error("exec failed");
+        } catch (const std::exception& err) {
+            child_fail(err);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "aucont_common.h"
+#include "aucont_runtime.h"
+
+namespace aucont
+{
+    /**
+     * Runs command inside given container: forks helper process, which joins
+     * container namespaces and cgroup, executes command and waits for it.
+     * Throws aucont_error if helper can't be started
+     * @param root_dir aucont root dir (cpu and v2 cgroup hierarchies are there)
+     * @param args     command and its arguments
+     * @return pid of helper (child of caller), which exits with command exit code
+     */
+    pid_t spawn_in_container(const container_t& cont, const std::string& root_dir,
+                             const std::vector<std::string>& args, const exec_options& exec_opts);
+}
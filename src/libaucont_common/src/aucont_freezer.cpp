@@ -0,0 +1,138 @@
+#include "aucont_freezer.h"
+#include "aucont_common.h"
+
+#include <fstream>
+#include <set>
+#include <string>
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <unistd.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        const int64_t freeze_timeout_ms = 5000;
+        const useconds_t freeze_poll_interval_us = 1000;
+
+        string get_freezer_cgroup_dir(const string& root_dir, pid_t pid)
+        {
+            return get_freezer_path(root_dir) + "/cont_" + std::to_string(pid);
+        }
+
+        string read_file(const string& path)
+        {
+            std::ifstream in(path);
+            if (!in) {
+                throw_error("Can't read " + path);
+            }
+            return string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        void write_file(const string& path, const string& value)
+        {
+            std::ofstream out(path);
+            out << value;
+            out.close();
+            if (out.fail()) {
+                throw_error("Can't write " + path);
+            }
+        }
+
+        bool is_cgroup_v2(const string& dir)
+        {
+            return access((dir + "/cgroup.freeze").c_str(), F_OK) == 0;
+        }
+
+        std::set<pid_t> get_cgroup_procs(const string& dir)
+        {
+            std::ifstream in(dir + "/cgroup.procs");
+            std::set<pid_t> procs;
+            pid_t pid;
+            while (in >> pid) {
+                procs.insert(pid);
+            }
+            return procs;
+        }
+
+        /**
+         * creates freezer cgroup for container (if needed) and moves given processes there
+         */
+        void move_to_freezer_cgroup(const string& root_dir, pid_t pid, const std::set<pid_t>& procs)
+        {
+            string pids;
+            for (auto proc : procs) {
+                pids += std::to_string(proc) + " ";
+            }
+            const string script = root_dir + "/setup_freezer_cgroup.sh";
+            if (sysrun(script, pids, get_freezer_path(root_dir), "cont_" + std::to_string(pid)) != 0) {
+                throw_error("Can't setup freezer cgroup for container " + std::to_string(pid));
+            }
+        }
+
+        /**
+         * writes freezer state and waits until kernel reports it is reached
+         */
+        void set_frozen(const string& dir, bool frozen)
+        {
+            bool v2 = is_cgroup_v2(dir);
+            string state_file = dir + (v2 ? "/cgroup.freeze" : "/freezer.state");
+            string state = v2 ? (frozen ? "1" : "0") : (frozen ? "FROZEN" : "THAWED");
+            string confirm_file = dir + (v2 ? "/cgroup.events" : "/freezer.state");
+            string confirmed = v2 ? (frozen ? "frozen 1" : "frozen 0") : state;
+
+            write_file(state_file, state);
+            auto deadline = monotonic_ms() + freeze_timeout_ms;
+            while (read_file(confirm_file).find(confirmed) == string::npos) {
+                if (monotonic_ms() > deadline) {
+                    throw_error("Timed out waiting for " + state + " state of " + dir, ETIMEDOUT);
+                }
+                usleep(freeze_poll_interval_us);
+                if (!v2) {
+                    // v1 freezer may get stuck in FREEZING, rewriting state retries freezing
+                    write_file(state_file, state);
+                }
+            }
+        }
+    }
+
+    string get_freezer_path(const string& root_dir)
+    {
+        return root_dir + "/freezerh";
+    }
+
+    void pause_container(const string& root_dir, pid_t pid)
+    {
+        auto dir = get_freezer_cgroup_dir(root_dir, pid);
+        move_to_freezer_cgroup(root_dir, pid, get_container_procs(pid));
+        set_frozen(dir, true);
+        // processes forked while others were moved may escape freezer cgroup;
+        // being moved into already frozen cgroup, they are frozen too
+        while (true) {
+            auto in_cgroup = get_cgroup_procs(dir);
+            std::set<pid_t> escaped;
+            for (auto proc : get_container_procs(pid)) {
+                if (in_cgroup.count(proc) == 0) {
+                    escaped.insert(proc);
+                }
+            }
+            if (escaped.empty()) {
+                break;
+            }
+            move_to_freezer_cgroup(root_dir, pid, escaped);
+            set_frozen(dir, true);
+        }
+    }
+
+    void resume_container(const string& root_dir, pid_t pid)
+    {
+        auto dir = get_freezer_cgroup_dir(root_dir, pid);
+        if (access(dir.c_str(), F_OK) == 0) {
+            set_frozen(dir, false);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#include <sys/types.h>
+
+namespace aucont
+{
+    /**
+     * returns root path of freezer cgroup hierarchy, which is mounted
+     * during first container pause
+     * @param root_dir aucont root dir
+     */
+    std::string get_freezer_path(const std::string& root_dir);
+
+    /**
+     * Freezes all processes of container with cgroup freezer (v1 `freezer.state`
+     * or v2 `cgroup.freeze`, whatever is mounted) and waits until kernel confirms
+     * frozen state. Throws aucont_error on failure
+     */
+    void pause_container(const std::string& root_dir, pid_t pid);
+
+    /**
+     * Thaws container frozen with `pause_container` and waits for it to be thawed.
+     * Throws aucont_error on failure
+     */
+    void resume_container(const std::string& root_dir, pid_t pid);
+}
@@ -0,0 +1,180 @@
+#include "aucont_log_collector.h"
+#include "aucont_common.h"
+
+#include <string>
+
+#include <cerrno>
+#include <cstdio>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        const int log_buffer_size = 1024 * 1024; // in-memory buffer between container and disk
+        const size_t splice_chunk = 64 * 1024;
+
+        int open_log(const string& path)
+        {
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+            if (fd < 0) {
+                throw_stdlib_error("Can't open log file " + path);
+            }
+            return fd;
+        }
+
+        /**
+         * Moves buffered output to log file, rotating it after `max_size` bytes.
+         * This is the only place, where disk writes (and so blocking on disk) happen
+         */
+        void write_log(int buf_fd, const string& path, size_t max_size)
+        {
+            int log_fd = open_log(path);
+            size_t size = 0;
+            while (true) {
+                ssize_t ret = splice(buf_fd, NULL, log_fd, NULL, splice_chunk, SPLICE_F_MOVE);
+                if (ret == 0) {
+                    break;
+                } else if (ret < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_stdlib_error("Can't write log " + path);
+                }
+                size += ret;
+                if (size >= max_size) {
+                    close(log_fd);
+                    if (rename(path.c_str(), (path + ".1").c_str()) != 0) {
+                        throw_stdlib_error("Can't rotate log " + path);
+                    }
+                    log_fd = open_log(path);
+                    size = 0;
+                }
+            }
+            close(log_fd);
+        }
+
+        /**
+         * Keeps container output pipe drained into `buf_fd` (non-blocking pipe),
+         * dropping output if buffer is full
+         */
+        void drain_output(int out_fd, int buf_fd)
+        {
+            int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+            if (null_fd < 0) {
+                throw_stdlib_error("Can't open /dev/null");
+            }
+            size_t dropped = 0;
+            while (true) {
+                struct pollfd pfd = { out_fd, POLLIN, 0 };
+                if (poll(&pfd, 1, -1) < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_stdlib_error("Can't poll container output");
+                }
+                if (dropped > 0) {
+                    string note = "\n[aucont: " + std::to_string(dropped) + " bytes of output dropped]\n";
+                    if (write(buf_fd, note.c_str(), note.size()) == static_cast<ssize_t>(note.size())) {
+                        dropped = 0;
+                    }
+                }
+                ssize_t ret = splice(out_fd, NULL, buf_fd, NULL, splice_chunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (ret < 0 && errno == EAGAIN) {
+                    // output is ready (polled), so buffer is full: disk is behind, dropping
+                    ret = splice(out_fd, NULL, null_fd, NULL, splice_chunk, SPLICE_F_NONBLOCK);
+                    if (ret > 0) {
+                        dropped += ret;
+                        continue;
+                    }
+                }
+                if (ret == 0) {
+                    break; // all writers are gone
+                } else if (ret < 0 && errno != EAGAIN && errno != EINTR) {
+                    throw_stdlib_error("Can't read container output");
+                }
+            }
+            close(null_fd);
+        }
+    }
+
+    std::string get_log_path(const std::string& root_dir, pid_t pid)
+    {
+        return root_dir + "/logs/" + std::to_string(pid) + ".log";
+    }
+
+    void start_log_collector(int out_fd, const string& log_path, size_t max_size)
+    {
+        string log_dir = log_path.substr(0, log_path.find_last_of('/'));
+        if (mkdir(log_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+            throw_stdlib_error("Can't create log directory " + log_dir);
+        }
+        // double fork: collector is reparented to init, so caller has nothing to reap
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw_stdlib_error("Can't fork log collector");
+        } else if (pid > 0) {
+            if (waitpid(pid, NULL, 0) < 0) {
+                throw_stdlib_error("waitpid failed for log collector");
+            }
+            return;
+        }
+        try {
+            // caller's fds (of all its threads) would outlive it in collector
+            out_fd = close_inherited_fds(out_fd);
+            // collector must survive caller's terminal session
+            if (setsid() < 0) {
+                throw_stdlib_error("Can't detach log collector");
+            }
+            pid = fork();
+            if (pid < 0) {
+                throw_stdlib_error("Can't fork log collector");
+            } else if (pid > 0) {
+                _exit(0);
+            }
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                if (null_fd > STDERR_FILENO) {
+                    close(null_fd);
+                }
+            }
+
+            int buf_fds[2];
+            if (pipe2(buf_fds, O_CLOEXEC) != 0) {
+                throw_stdlib_error("Can't create log buffer");
+            }
+            fcntl(buf_fds[1], F_SETPIPE_SZ, log_buffer_size); // best effort, limited by fs.pipe-max-size
+            if (fcntl(buf_fds[1], F_SETFL, O_NONBLOCK) != 0) {
+                throw_stdlib_error("Can't make log buffer non-blocking");
+            }
+
+            pid_t writer_pid = fork();
+            if (writer_pid < 0) {
+                throw_stdlib_error("Can't fork log writer");
+            } else if (writer_pid == 0) {
+                close(buf_fds[1]);
+                close(out_fd);
+                write_log(buf_fds[0], log_path, max_size);
+                _exit(0);
+            }
+            close(buf_fds[0]);
+            drain_output(out_fd, buf_fds[1]);
+            close(out_fd);
+            close(buf_fds[1]);
+            waitpid(writer_pid, NULL, 0);
+        } catch (const std::exception& err) {
+            child_fail(err);
+        }
+        _exit(0);
+    }
+}
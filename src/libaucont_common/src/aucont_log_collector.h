@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#include <sys/types.h>
+
+namespace aucont
+{
+    /**
+     * returns path to output log of container with given pid
+     */
+    std::string get_log_path(const std::string& root_dir, pid_t pid);
+
+    /**
+     * Starts detached process, which drains container output from `out_fd`
+     * (read end of pipe) into rotating log file at `log_path`.
+     * Container never blocks on log writing: if disk can't keep up and
+     * in-memory buffer is full, output is dropped (and drop is noted in log).
+     * Collector is not a child of caller and holds no other fds of it.
+     * Throws aucont_error on failure
+     * @param out_fd       read end of container stdout/stderr pipe
+     * @param log_path     path to log file; previous part is kept in `log_path + ".1"`
+     * @param max_size     max size of one log part in bytes
+     */
+    void start_log_collector(int out_fd, const std::string& log_path, size_t max_size);
+}
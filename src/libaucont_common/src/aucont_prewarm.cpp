@@ -0,0 +1,156 @@
+#include "aucont_prewarm.h"
+#include "aucont_common.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        const int max_nftw_fds = 16;
+
+        /**
+         * Asks kernel to start reading whole file into page cache; doesn't wait for io
+         */
+        void prewarm_file(const char* path)
+        {
+            int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOATIME);
+            if (fd < 0 && errno == EPERM) { // O_NOATIME is allowed for file owner only
+                fd = open(path, O_RDONLY | O_CLOEXEC);
+            }
+            if (fd < 0) {
+                return;
+            }
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+
+        int prewarm_tree_entry(const char* path, const struct stat* st, int type, struct FTW*)
+        {
+            if (type == FTW_F && S_ISREG(st->st_mode)) {
+                prewarm_file(path);
+            }
+            return 0;
+        }
+
+        void prewarm_path(const string& path)
+        {
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0) {
+                return;
+            }
+            if (S_ISDIR(st.st_mode)) {
+                nftw(path.c_str(), prewarm_tree_entry, max_nftw_fds, FTW_PHYS | FTW_MOUNT);
+            } else if (S_ISREG(st.st_mode)) {
+                prewarm_file(path.c_str());
+            }
+        }
+
+        void record_mapped_files_of(pid_t pid, const string& image_root, std::set<string>& trace)
+        {
+            string proc_dir = "/proc/" + std::to_string(pid);
+            std::ifstream maps(proc_dir + "/maps");
+            string line;
+            while (std::getline(maps, line)) {
+                // address perms offset dev inode path
+                auto path_pos = line.find('/');
+                if (path_pos == string::npos || line.find(" (deleted)") != string::npos) {
+                    continue;
+                }
+                string path = line.substr(path_pos);
+                if (trace.count(path) != 0) {
+                    continue;
+                }
+                // paths are seen from container root, but the very first snapshot may be
+                // taken before pivot_root, so files, which are not in image, are skipped
+                struct stat st;
+                if (stat((image_root + path).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                    trace.insert(path);
+                }
+            }
+            std::ifstream children(proc_dir + "/task/" + std::to_string(pid) + "/children");
+            pid_t child;
+            while (children >> child) {
+                record_mapped_files_of(child, image_root, trace);
+            }
+        }
+    }
+
+    void start_prewarm(const string& image_root, const string& list_file)
+    {
+        std::ifstream in(list_file);
+        if (!in) {
+            throw_error("Can't open prewarm list " + list_file);
+        }
+        std::vector<string> paths;
+        string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            if (line[0] != '/') {
+                line = "/" + line;
+            }
+            paths.push_back(image_root + line);
+        }
+
+        // double fork: prewarming process is reparented to init, so caller has nothing to reap
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw_stdlib_error("Can't fork prewarm process");
+        } else if (pid > 0) {
+            if (waitpid(pid, NULL, 0) < 0) {
+                throw_stdlib_error("waitpid failed for prewarm process");
+            }
+            return;
+        }
+        if (fork() != 0) {
+            _exit(0);
+        }
+        try {
+            // caller's fds (of all its threads) would outlive it here
+            close_inherited_fds();
+        } catch (const std::exception& err) {
+            child_fail(err);
+        }
+        for (const auto& path : paths) {
+            prewarm_path(path);
+        }
+        _exit(0);
+    }
+
+    void record_mapped_files(pid_t pid, const string& image_root, std::set<string>& trace)
+    {
+        string root = image_root;
+        if (!root.empty() && root[root.length() - 1] == '/') {
+            root = root.substr(0, root.length() - 1);
+        }
+        record_mapped_files_of(pid, root, trace);
+    }
+
+    void write_prewarm_list(const string& list_file, const std::set<string>& trace)
+    {
+        std::ofstream out(list_file, std::ios_base::trunc | std::ios_base::out);
+        if (!out) {
+            throw_error("Can't write prewarm list " + list_file);
+        }
+        out << "# recorded by aucont_start --prewarm-record" << std::endl;
+        for (const auto& path : trace) {
+            out << path << std::endl;
+        }
+    }
+}
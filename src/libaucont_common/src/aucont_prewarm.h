@@ -0,0 +1,32 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+#include <sys/types.h>
+
+namespace aucont
+{
+    /**
+     * Starts page cache prewarming of container image files in separate detached
+     * process (holding no other fds of caller), so it runs in parallel with
+     * container namespaces setup.
+     * Throws aucont_error on failure
+     * @param image_root path to container image root
+     * @param list_file  file with paths (relative to image root) to prewarm, one per line;
+     *                   directories are prewarmed recursively
+     */
+    void start_prewarm(const std::string& image_root, const std::string& list_file);
+
+    /**
+     * Adds image files, which are currently mapped by given process or any of its
+     * descendants, to `trace`. Paths are stored relative to image root
+     */
+    void record_mapped_files(pid_t pid, const std::string& image_root, std::set<std::string>& trace);
+
+    /**
+     * Writes recorded trace in format accepted by `start_prewarm`.
+     * Throws aucont_error on failure
+     */
+    void write_prewarm_list(const std::string& list_file, const std::set<std::string>& trace);
+}
@@ -0,0 +1,164 @@
+#include "aucont_ready.h"
+#include "aucont_common.h"
+
+#include <algorithm>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        const int probe_interval_ms = 10;
+        const int connect_timeout_ms = 1000;
+        const char ready_msg[] = "READY=1";
+
+        /**
+         * ms left before deadline, 0 if it passed and -1 if there is no deadline (< 0)
+         */
+        int time_left(int64_t deadline)
+        {
+            if (deadline < 0) {
+                return -1;
+            }
+            auto left = deadline - monotonic_ms();
+            return left < 0 ? 0 : static_cast<int>(left);
+        }
+
+        [[noreturn]] void throw_exited(pid_t pid)
+        {
+            throw_error("Container " + std::to_string(pid) + " exited before it was ready", ECHILD);
+        }
+
+        /**
+         * sleeps `timeout_ms` between probes, but throws at once if container exits
+         */
+        void pause_probing(const container_handle& handle, int timeout_ms)
+        {
+            struct pollfd pfd = { handle.pidfd, POLLIN, 0 };
+            int ret = poll(&pfd, 1, timeout_ms);
+            if (ret > 0) {
+                throw_exited(handle.pid);
+            } else if (ret < 0 && errno != EINTR) {
+                throw_stdlib_error("Can't wait for container");
+            }
+        }
+
+        bool wait_notify(const container_handle& handle, int64_t deadline)
+        {
+            if (handle.ready_fd < 0) {
+                throw_error("Readiness of container " + std::to_string(handle.pid) + " is already awaited");
+            }
+            // workload may send other sd_notify variables too, message may come in several writes
+            string received;
+            while (received.find(ready_msg) == string::npos) {
+                struct pollfd pfds[2] = { { handle.ready_fd, POLLIN, 0 }, { handle.pidfd, POLLIN, 0 } };
+                int ret = poll(pfds, 2, time_left(deadline));
+                if (ret < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_stdlib_error("Can't wait for container readiness");
+                } else if (ret == 0) {
+                    return false;
+                }
+                // message, sent right before exit, is still read
+                if (pfds[0].revents == 0) {
+                    throw_exited(handle.pid);
+                }
+                char buf[256];
+                ssize_t len = recv(handle.ready_fd, buf, sizeof(buf), MSG_DONTWAIT);
+                if (len < 0 && errno != EINTR && errno != EAGAIN) {
+                    throw_stdlib_error("Can't read readiness socket of container");
+                } else if (len > 0) {
+                    received.append(buf, len);
+                }
+            }
+            return true;
+        }
+
+        bool tcp_accepts(const string& ip, uint16_t port, int timeout_ms)
+        {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                throw_stdlib_error("Can't create readiness probe socket");
+            }
+            struct sockaddr_in addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            inet_aton(ip.c_str(), &addr.sin_addr);
+            bool accepted = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+            if (!accepted && errno == EINPROGRESS) {
+                struct pollfd pfd = { fd, POLLOUT, 0 };
+                int err = 0;
+                socklen_t err_len = sizeof(err);
+                accepted = poll(&pfd, 1, timeout_ms) > 0 &&
+                           getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0;
+            }
+            close(fd);
+            return accepted;
+        }
+    }
+
+    void check_ready_probe(const options& opts)
+    {
+        const auto& probe = opts.ready_probe;
+        if (probe == "notify") {
+            return;
+        }
+        if (probe.compare(0, 4, "tcp:") == 0) {
+            string port = probe.substr(4);
+            if (port.empty() || port.length() > 5 ||
+                std::any_of(port.begin(), port.end(), [](char c){ return !std::isdigit(c); }) ||
+                std::stoi(port) < 1 || std::stoi(port) > 65535) {
+                throw_error("Readiness port must be in [1, 65535]");
+            }
+            if (opts.ip.empty()) {
+                throw_error("Tcp readiness probe requires container network (ip)");
+            }
+            return;
+        }
+        if (probe.compare(0, 5, "file:") == 0 && probe.length() > 5 && probe[5] == '/') {
+            return;
+        }
+        throw_error("Readiness probe must be `notify`, `tcp:PORT` or `file:/PATH`");
+    }
+
+    bool wait_container_ready(const container_handle& handle, const options& opts, int timeout_ms)
+    {
+        int64_t deadline = timeout_ms < 0 ? -1 : monotonic_ms() + timeout_ms;
+        if (opts.ready_probe == "notify") {
+            return wait_notify(handle, deadline);
+        }
+
+        bool tcp = opts.ready_probe.compare(0, 4, "tcp:") == 0;
+        string target = opts.ready_probe.substr(opts.ready_probe.find(':') + 1);
+        // path is resolved in container's mount namespace, from container root
+        string path = "/proc/" + std::to_string(handle.pid) + "/root" + target;
+        while (true) {
+            int left = time_left(deadline);
+            bool ready = tcp ?
+                tcp_accepts(opts.ip, std::stoi(target), left < 0 ? connect_timeout_ms : std::min(left, connect_timeout_ms)) :
+                access(path.c_str(), F_OK) == 0;
+            if (ready) {
+                return true;
+            }
+            left = time_left(deadline);
+            if (left == 0) {
+                return false;
+            }
+            pause_probing(handle, left < 0 ? probe_interval_ms : std::min(left, probe_interval_ms));
+        }
+    }
+}
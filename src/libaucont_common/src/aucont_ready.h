@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "aucont_runtime.h"
+
+namespace aucont
+{
+    /**
+     * environment variable with readiness socket fd of `notify` probe
+     */
+    const char ready_fd_env[] = "AUCONT_READY_FD";
+
+    /**
+     * Checks `opts.ready_probe`, which is one of
+     *   notify    - workload writes `READY=1` (sd_notify style) into datagram socket, which
+     *               fd number is passed in AUCONT_READY_FD environment variable; once
+     *               readiness is awaited, writes into it fail with ECONNREFUSED
+     *   tcp:PORT  - aucont connects to PORT of container ip (requires container network)
+     *   file:PATH - aucont checks, that absolute PATH exists in container filesystem
+     * Throws aucont_error if probe is malformed
+     */
+    void check_ready_probe(const options& opts);
+
+    /**
+     * Waits for workload of container to become ready according to `opts.ready_probe`.
+     * Probes of aucont are repeated every 10 ms, `notify` one is waited without polling.
+     * Throws aucont_error (ECHILD) if container exits before it is ready
+     * @return false if workload isn't ready after `timeout_ms` (-1 to wait forever)
+     */
+    bool wait_container_ready(const container_handle& handle, const options& opts, int timeout_ms);
+}
@@ -0,0 +1,186 @@
+#include "aucont_registry.h"
+
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <csignal>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+namespace aucont
+{
+    namespace
+    {
+        bool is_proc_dead(pid_t pid)
+        {
+            return kill(pid, 0) == -1 && errno == ESRCH;
+        }
+
+        /**
+         * Exclusive lock of registry, released on destruction
+         */
+        class registry_lock
+        {
+        public:
+            explicit registry_lock(const std::string& lock_file)
+            {
+                fd = open(lock_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+                if (fd < 0) {
+                    throw_stdlib_error("Can't open registry lock " + lock_file);
+                }
+                while (flock(fd, LOCK_EX) != 0) {
+                    if (errno != EINTR) {
+                        close(fd);
+                        throw_stdlib_error("Can't lock registry");
+                    }
+                }
+            }
+
+            ~registry_lock()
+            {
+                close(fd); // releases lock
+            }
+
+            registry_lock(const registry_lock&) = delete;
+            registry_lock& operator=(const registry_lock&) = delete;
+
+        private:
+            int fd;
+        };
+    }
+
+    registry::registry(std::string root_dir)
+    : root_dir(root_dir), pids_file(root_dir + "/containers"), lock_file(root_dir + "/containers.lock")
+    {}
+
+    std::set<container_t> registry::read_containers() const
+    {
+        std::set<container_t> conts;
+        std::ifstream in(pids_file.c_str(), std::ios_base::in | std::ios_base::binary);
+        if (in.fail()) {
+            if (errno == ENOENT) {
+                return conts;
+            }
+            throw_stdlib_error("Can't open file with containers info for read");
+        }
+        container_t cont;
+        while (in.read(reinterpret_cast<char*>(&cont), sizeof(container_t) / sizeof(char))) {
+            conts.insert(cont);
+        }
+        return conts;
+    }
+
+    void registry::write_containers(const std::set<container_t>& conts) const
+    {
+        std::ofstream out(pids_file.c_str(), std::ios_base::trunc | std::ios_base::out | std::ios_base::binary);
+        if (out.fail()) {
+            throw_stdlib_error("Can't open file with containers pids for write");
+        }
+        for (auto& cont : conts) {
+            out.write(reinterpret_cast<const char*>(&cont), sizeof(container_t) / sizeof(char));
+        }
+        out.close();
+        if (out.fail()) {
+            throw_stdlib_error("Can't write file with containers pids");
+        }
+    }
+
+    template<typename F>
+    std::vector<container_t> registry::modify(F fn, bool prune) const
+    {
+        if (mkdir(root_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+            throw_stdlib_error("Can't create directory [ " + root_dir + " ]");
+        }
+        registry_lock lock(lock_file);
+        auto conts = read_containers();
+        auto initial = conts;
+        if (prune) {
+            for (auto it = conts.begin(); it != conts.end();) {
+                it = is_proc_dead(it->pid) ? conts.erase(it) : std::next(it);
+            }
+        }
+        bool pruned = initial.size() != conts.size();
+        std::vector<container_t> removed;
+        if (!fn(conts) && !pruned) {
+            return removed;
+        }
+        write_containers(conts);
+        for (const auto& cont : initial) {
+            if (conts.count(cont) == 0) {
+                removed.push_back(cont);
+            }
+        }
+        return removed;
+    }
+
+    std::set<container_t> registry::get_containers() const
+    {
+        std::set<container_t> conts;
+        {
+            registry_lock lock(lock_file);
+            conts = read_containers();
+        }
+        for (auto it = conts.begin(); it != conts.end();) {
+            it = is_proc_dead(it->pid) ? conts.erase(it) : std::next(it);
+        }
+        return conts;
+    }
+
+    container_t registry::get_container(pid_t pid) const
+    {
+        auto conts = get_containers();
+        auto it = conts.find(container_t(pid));
+        return it == conts.end() ? container_t() : *it;
+    }
+
+    bool registry::add_container(const container_t& cont) const
+    {
+        bool added = false;
+        modify([&](std::set<container_t>& conts) {
+            auto it = conts.find(cont);
+            if (it != conts.end() && is_proc_dead(it->pid)) {
+                // pid is reused, new container takes over objects named after it
+                conts.erase(it);
+            }
+            added = conts.insert(cont).second;
+            return added;
+        }, false);
+        return added;
+    }
+
+    bool registry::update_container(const container_t& cont) const
+    {
+        bool updated = false;
+        modify([&](std::set<container_t>& conts) {
+            updated = conts.erase(cont) != 0;
+            if (updated) {
+                conts.insert(cont);
+            }
+            return updated;
+        }, false);
+        return updated;
+    }
+
+    std::vector<container_t> registry::del_containers(const std::set<pid_t>& pids) const
+    {
+        return modify([&](std::set<container_t>& conts) {
+            size_t deleted = 0;
+            for (auto pid : pids) {
+                deleted += conts.erase(container_t(pid));
+            }
+            return deleted > 0;
+        }, true);
+    }
+
+    std::vector<container_t> registry::prune() const
+    {
+        return modify([](std::set<container_t>&) {
+            return false;
+        }, true);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "aucont_common.h"
+
+namespace aucont
+{
+    /**
+     * Registry of running containers, stored as binary file in aucont root dir.
+     * Every operation is done under exclusive `flock` of registry lock file, so
+     * registry may be used concurrently from several threads and processes.
+     * Throws aucont_error on failure
+     */
+    class registry
+    {
+    public:
+        /**
+         * @param root_dir aucont root dir (registry file is created there)
+         */
+        explicit registry(std::string root_dir);
+
+        /**
+         * returns containers, which are still running; dead ones are skipped,
+         * but stay in registry until `prune` or `del_containers`
+         */
+        std::set<container_t> get_containers() const;
+
+        /**
+         * returns container with given pid or container with pid = -1 if there is no such
+         */
+        container_t get_container(pid_t pid) const;
+
+        /**
+         * @return false if container with same pid is already registered and
+         * running (dead one with reused pid is replaced)
+         */
+        bool add_container(const container_t& cont) const;
+
+        /**
+         * replaces registered container (with same pid) with given one
+         * @return false if container is not registered
+         */
+        bool update_container(const container_t& cont) const;
+
+        /**
+         * removes all given containers and dead ones with single registry rewrite
+         * @return removed containers; caller releases their host objects
+         *         (see `release_containers` in aucont_container.h)
+         */
+        std::vector<container_t> del_containers(const std::set<pid_t>& pids) const;
+
+        /**
+         * removes dead containers
+         * @return removed containers; caller releases their host objects
+         */
+        std::vector<container_t> prune() const;
+
+    private:
+        std::string root_dir;
+        std::string pids_file;
+        std::string lock_file;
+
+        /**
+         * calls `fn(conts)` with registry contents under lock (without dead
+         * containers if `prune`) and writes them back if `fn` returns true or
+         * dead containers are pruned
+         * @return containers, which are gone from registry (removed by `fn` or dead)
+         */
+        template<typename F>
+        std::vector<container_t> modify(F fn, bool prune) const;
+
+        std::set<container_t> read_containers() const;
+        void write_containers(const std::set<container_t>& conts) const;
+    };
+}
@@ -0,0 +1,573 @@
+#include "aucont_runtime.h"
+#include "aucont_agent.h"
+#include "aucont_checkpoint.h"
+#include "aucont_container.h"
+#include "aucont_exec.h"
+#include "aucont_freezer.h"
+#include "aucont_log_collector.h"
+#include "aucont_ready.h"
+
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <stdexcept>
+
+#include <cerrno>
+#include <csignal>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+namespace aucont
+{
+    using std::string;
+    using std::vector;
+
+    namespace
+    {
+        /**
+         * runs `fn`, converting exceptions to status
+         */
+        template<typename F>
+        status_t guarded(F fn)
+        {
+            try {
+                fn();
+            } catch (const aucont_error& err) {
+                return status_t(err.code(), err.what());
+            } catch (const std::exception& err) {
+                return status_t(EIO, err.what());
+            }
+            return status_t();
+        }
+
+        /**
+         * waits for process referred by pidfd to exit
+         * @return false if process is still running after timeout
+         */
+        bool wait_pidfd(int pidfd, int timeout_ms)
+        {
+            auto deadline = timeout_ms < 0 ? 0 : monotonic_ms() + timeout_ms;
+            while (true) {
+                int wait_ms = -1;
+                if (timeout_ms >= 0) {
+                    auto left = deadline - monotonic_ms();
+                    wait_ms = left < 0 ? 0 : static_cast<int>(left);
+                }
+                struct pollfd pfd = { pidfd, POLLIN, 0 };
+                int ret = poll(&pfd, 1, wait_ms);
+                if (ret > 0) {
+                    return true;
+                } else if (ret == 0) {
+                    return false;
+                } else if (errno != EINTR) {
+                    throw_stdlib_error("Can't wait for process");
+                }
+            }
+        }
+
+        int reap(pid_t pid)
+        {
+            int status = 0;
+            while (waitpid(pid, &status, 0) < 0) {
+                if (errno != EINTR) {
+                    throw_stdlib_error("waitpid failed for pid " + std::to_string(pid));
+                }
+            }
+            return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+
+        int send_signal(int pidfd, int signum)
+        {
+            return syscall(SYS_pidfd_send_signal, pidfd, signum, NULL, 0);
+        }
+
+        /**
+         * Container being stopped
+         */
+        struct stop_target
+        {
+            pid_t pid;
+            int pidfd; // -1 after container exited
+        };
+
+        /**
+         * Waits for all targets to exit (all at once, in one epoll loop).
+         * @param timeout_ms -1 to wait forever
+         * @return number of targets, which are still running
+         */
+        size_t wait_targets(int epoll_fd, vector<stop_target>& targets, size_t running, int timeout_ms)
+        {
+            const int max_events = 64;
+            struct epoll_event events[max_events];
+            auto deadline = timeout_ms < 0 ? 0 : monotonic_ms() + timeout_ms;
+            while (running > 0) {
+                int wait_ms = -1;
+                if (timeout_ms >= 0) {
+                    auto left = deadline - monotonic_ms();
+                    if (left <= 0) {
+                        break;
+                    }
+                    wait_ms = static_cast<int>(left);
+                }
+                int ready = epoll_wait(epoll_fd, events, max_events, wait_ms);
+                if (ready < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_stdlib_error("epoll_wait failed");
+                }
+                for (int i = 0; i < ready; ++i) {
+                    auto& target = targets[events[i].data.u32];
+                    if (target.pidfd >= 0) {
+                        close(target.pidfd); // also removes it from epoll set
+                        target.pidfd = -1;
+                        --running;
+                    }
+                }
+            }
+            return running;
+        }
+
+        /**
+         * adds cpu time and resident memory of process to stats
+         */
+        void add_proc_stats(pid_t pid, container_stats& stats)
+        {
+            string proc_dir = "/proc/" + std::to_string(pid);
+            std::ifstream stat_in(proc_dir + "/stat");
+            string stat;
+            if (!std::getline(stat_in, stat)) {
+                return; // process is already gone
+            }
+            // command name may contain spaces, fields are counted after it
+            std::stringstream fields(stat.substr(stat.rfind(')') + 2));
+            string field;
+            uint64_t utime = 0, stime = 0;
+            for (int i = 3; i <= 15 && fields >> field; ++i) {
+                if (i == 14) {
+                    utime = std::stoull(field);
+                } else if (i == 15) {
+                    stime = std::stoull(field);
+                }
+            }
+            stats.cpu_time_ms += (utime + stime) * 1000 / sysconf(_SC_CLK_TCK);
+
+            std::ifstream statm_in(proc_dir + "/statm");
+            uint64_t size = 0, resident = 0;
+            if (statm_in >> size >> resident) {
+                stats.rss_bytes += resident * sysconf(_SC_PAGESIZE);
+            }
+            stats.procs += 1;
+        }
+    }
+
+    Runtime::Runtime(string root_dir)
+    : root_dir(root_dir.length() > 1 && root_dir[root_dir.length() - 1] == '/' ?
+               root_dir.substr(0, root_dir.length() - 1) : root_dir),
+      reg(this->root_dir)
+    {}
+
+    status_t Runtime::start(const options& opts, container_handle& handle)
+    {
+        return guarded([&]() {
+            if (opts.fsimg_path.empty()) {
+                throw_error("No image path specified");
+            }
+            if (opts.args.empty()) {
+                throw_error("No command specified to run inside container");
+            }
+            if (opts.cpu_perc < 1 || opts.cpu_perc > 100) {
+                throw_error("Percent of cpu usage must be in [1, 100]");
+            }
+            if ((opts.cpu_min != 0 || opts.cpu_max != 0) &&
+                (opts.cpu_min < 1 || opts.cpu_min > opts.cpu_max || opts.cpu_max > 100)) {
+                throw_error("Cpu range must be MIN:MAX with 1 <= MIN <= MAX <= 100");
+            }
+            if (opts.mem_min > opts.mem_max) {
+                throw_error("Memory range must be MIN:MAX with MIN <= MAX");
+            }
+            if (opts.log && !opts.daemonize) {
+                throw_error("Output can be logged only for daemonized container");
+            }
+            if (opts.exec_agent && !opts.init) {
+                throw_error("Exec agent is run by container init, it requires `init` option");
+            }
+            if (opts.net_prio != "interactive" && opts.net_prio != "normal" && opts.net_prio != "bulk") {
+                throw_error("Network priority must be `interactive`, `normal` or `bulk`");
+            }
+            if ((opts.net_rate > 0 || opts.net_burst > 0 || opts.net_prio != "normal") && opts.ip.empty()) {
+                throw_error("Network shaping requires container network (ip)");
+            }
+            if (!opts.ports.empty() && opts.ip.empty()) {
+                throw_error("Ports can be published only for container with network (ip)");
+            }
+            for (size_t i = 0; i < opts.ports.size(); ++i) {
+                const auto& port = opts.ports[i];
+                if (port.host_port == 0 || port.cont_port == 0) {
+                    throw_error("Port must be in [1, 65535]");
+                }
+                for (size_t j = 0; j < i; ++j) {
+                    if (opts.ports[j].host_port == port.host_port && opts.ports[j].udp == port.udp) {
+                        throw_error("Host port " + std::to_string(port.host_port) + " is published twice");
+                    }
+                }
+            }
+            if (!opts.ready_probe.empty()) {
+                check_ready_probe(opts);
+            }
+            // objects of dead container are named after its pid, which new one may get
+            release_containers(root_dir, reg.prune());
+            handle = start_container(opts, root_dir, reg);
+        });
+    }
+
+    status_t Runtime::wait(container_handle& handle, int timeout_ms, int* exit_code)
+    {
+        return guarded([&]() {
+            if (handle.pidfd < 0) {
+                throw_error("Invalid container handle");
+            }
+            if (!wait_pidfd(handle.pidfd, timeout_ms)) {
+                throw_error("Container " + std::to_string(handle.pid) + " is still running", ETIMEDOUT);
+            }
+            int code = handle.child ? reap(handle.pid) : -1;
+            if (exit_code != nullptr) {
+                *exit_code = code;
+            }
+            close(handle.pidfd);
+            if (handle.ready_fd >= 0) {
+                close(handle.ready_fd);
+            }
+            release_containers(root_dir, reg.del_containers({ handle.pid }));
+            handle = container_handle();
+        });
+    }
+
+    status_t Runtime::wait_ready(container_handle& handle, const options& opts, int timeout_ms)
+    {
+        return guarded([&]() {
+            if (handle.pidfd < 0) {
+                throw_error("Invalid container handle");
+            }
+            if (opts.ready_probe.empty()) {
+                throw_error("Container " + std::to_string(handle.pid) + " has no readiness probe");
+            }
+            auto finish = [&](bool ready) {
+                // readiness is awaited once, workload's later messages are refused
+                if (handle.ready_fd >= 0) {
+                    close(handle.ready_fd);
+                    handle.ready_fd = -1;
+                }
+                auto cont = reg.get_container(handle.pid);
+                cont.readiness = ready ? readiness_ready : readiness_failed;
+                reg.update_container(cont);
+            };
+            bool ready = false;
+            try {
+                ready = wait_container_ready(handle, opts, timeout_ms);
+            } catch (const aucont_error&) {
+                finish(false);
+                throw;
+            }
+            finish(ready);
+            if (!ready) {
+                throw_error("Container " + std::to_string(handle.pid) + " isn't ready after " +
+                            std::to_string(timeout_ms) + " ms", ETIMEDOUT);
+            }
+        });
+    }
+
+    status_t Runtime::exec(const container_t& cont, const vector<string>& args,
+                           const exec_options& exec_opts, exec_handle& handle)
+    {
+        return guarded([&]() {
+            if (cont.paused) {
+                throw_error("Container " + std::to_string(cont.pid) + " is paused, resume it first", EBUSY);
+            }
+            if (exec_opts.agent) {
+                handle = exec_handle();
+                handle.agent_fd = agent_exec(root_dir, cont.pid, args, exec_opts);
+                publish_exec_event(root_dir, cont.pid, args);
+                return;
+            }
+            pid_t pid = spawn_in_container(cont, root_dir, args, exec_opts);
+            int pidfd = open_pidfd(pid);
+            if (pidfd < 0) {
+                int err = errno;
+                kill(pid, SIGKILL);
+                reap(pid);
+                errno = err;
+                throw_stdlib_error("Can't open pidfd");
+            }
+            handle.pid = pid;
+            handle.pidfd = pidfd;
+            publish_exec_event(root_dir, cont.pid, args);
+        });
+    }
+
+    status_t Runtime::wait_exec(exec_handle& handle, int timeout_ms, int& exit_code)
+    {
+        return guarded([&]() {
+            int wait_fd = handle.agent_fd >= 0 ? handle.agent_fd : handle.pidfd;
+            if (wait_fd < 0) {
+                throw_error("Invalid exec handle");
+            }
+            // exit code message makes agent connection readable just like exit makes pidfd
+            if (!wait_pidfd(wait_fd, timeout_ms)) {
+                throw_error("Command is still running", ETIMEDOUT);
+            }
+            if (handle.agent_fd >= 0) {
+                try {
+                    exit_code = read_agent_exit_code(handle.agent_fd);
+                } catch (...) {
+                    close(handle.agent_fd);
+                    handle = exec_handle();
+                    throw;
+                }
+            } else {
+                exit_code = reap(handle.pid);
+            }
+            close(wait_fd);
+            handle = exec_handle();
+        });
+    }
+
+    status_t Runtime::stop(const vector<pid_t>& pids, int signum, int timeout_ms, vector<pid_t>* killed)
+    {
+        vector<stop_target> targets;
+        int epoll_fd = -1;
+        auto status = guarded([&]() {
+            // dead containers are released right away, then registry is read only once for all containers
+            release_containers(root_dir, reg.prune());
+            auto conts = reg.get_containers();
+
+            // pidfds guarantee, that signals (including late SIGKILL) can't hit reused pid
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd < 0) {
+                throw_stdlib_error("Can't create epoll instance");
+            }
+            for (auto pid : pids) {
+                auto it = conts.find(container_t(pid));
+                if (it == conts.end()) {
+                    continue;
+                }
+                int pidfd = open_pidfd(pid);
+                if (pidfd < 0) {
+                    if (errno == ESRCH) {
+                        continue; // already gone
+                    }
+                    throw_stdlib_error("Can't open pidfd for container " + std::to_string(pid));
+                }
+                targets.push_back({ pid, pidfd });
+                if (send_signal(pidfd, signum) < 0 && errno != ESRCH) {
+                    throw_stdlib_error("Can't send signal");
+                }
+                if (it->paused) {
+                    // frozen processes get signal only after thaw; if thaw fails
+                    // container is still killed by SIGKILL after timeout
+                    guarded([&]() { resume_container(root_dir, pid); });
+                }
+                struct epoll_event ev;
+                ev.events = EPOLLIN;
+                ev.data.u32 = targets.size() - 1;
+                if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pidfd, &ev) < 0) {
+                    throw_stdlib_error("Can't watch container " + std::to_string(pid));
+                }
+            }
+            if (timeout_ms < 0) {
+                return;
+            }
+
+            size_t running = wait_targets(epoll_fd, targets, targets.size(), timeout_ms);
+            if (running > 0) {
+                for (const auto& target : targets) {
+                    if (target.pidfd < 0) {
+                        continue;
+                    }
+                    if (killed != nullptr) {
+                        killed->push_back(target.pid);
+                    }
+                    if (send_signal(target.pidfd, SIGKILL) < 0 && errno != ESRCH) {
+                        throw_stdlib_error("Can't send SIGKILL");
+                    }
+                }
+                wait_targets(epoll_fd, targets, running, -1);
+            }
+            release_containers(root_dir, reg.del_containers(std::set<pid_t>(pids.begin(), pids.end())));
+        });
+        for (const auto& target : targets) {
+            if (target.pidfd >= 0) {
+                close(target.pidfd);
+            }
+        }
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+        }
+        return status;
+    }
+
+    status_t Runtime::prune(vector<pid_t>* pruned)
+    {
+        return guarded([&]() {
+            auto removed = reg.prune();
+            release_containers(root_dir, removed);
+            if (pruned != nullptr) {
+                for (const auto& cont : removed) {
+                    pruned->push_back(cont.pid);
+                }
+            }
+        });
+    }
+
+    status_t Runtime::list(vector<container_t>& conts)
+    {
+        return guarded([&]() {
+            auto running = reg.get_containers();
+            conts.assign(running.begin(), running.end());
+        });
+    }
+
+    status_t Runtime::get(pid_t pid, container_t& cont)
+    {
+        return guarded([&]() {
+            cont = reg.get_container(pid);
+            if (cont.pid == -1) {
+                throw_error("No container running with pid " + std::to_string(pid), ESRCH);
+            }
+        });
+    }
+
+    status_t Runtime::stats(pid_t pid, container_stats& stats)
+    {
+        container_t cont;
+        auto status = get(pid, cont);
+        if (!status.ok()) {
+            return status;
+        }
+        return guarded([&]() {
+            stats = container_stats();
+            stats.paused = cont.paused;
+            for (auto proc : get_container_procs(pid)) {
+                add_proc_stats(proc, stats);
+            }
+        });
+    }
+
+    status_t Runtime::pause(pid_t pid)
+    {
+        container_t cont;
+        auto status = get(pid, cont);
+        if (!status.ok()) {
+            return status;
+        }
+        return guarded([&]() {
+            pause_container(root_dir, pid);
+            cont.paused = true;
+            reg.update_container(cont);
+        });
+    }
+
+    status_t Runtime::resume(pid_t pid)
+    {
+        container_t cont;
+        auto status = get(pid, cont);
+        if (!status.ok()) {
+            return status;
+        }
+        return guarded([&]() {
+            resume_container(root_dir, pid);
+            cont.paused = false;
+            reg.update_container(cont);
+        });
+    }
+
+    status_t Runtime::checkpoint(pid_t pid, const checkpoint_options& opts, string& snapshot)
+    {
+        container_t cont;
+        auto status = get(pid, cont);
+        if (!status.ok()) {
+            return status;
+        }
+        return guarded([&]() {
+            snapshot = checkpoint_container(root_dir, cont, opts);
+            if (!opts.leave_running) {
+                // CRIU has killed container after dump
+                release_containers(root_dir, reg.del_containers({ pid }));
+            }
+        });
+    }
+
+    status_t Runtime::restore(const string& snapshot, container_handle& handle)
+    {
+        return guarded([&]() {
+            handle = restore_container(snapshot, root_dir, reg);
+        });
+    }
+
+    status_t Runtime::watch(const std::function<bool(const event_t&)>& on_event, int timeout_ms)
+    {
+        return guarded([&]() {
+            event_monitor monitor(root_dir);
+            auto deadline = timeout_ms < 0 ? 0 : monotonic_ms() + timeout_ms;
+            vector<event_t> events;
+            while (true) {
+                int wait_ms = -1;
+                if (timeout_ms >= 0) {
+                    auto left = deadline - monotonic_ms();
+                    if (left < 0) {
+                        return;
+                    }
+                    wait_ms = static_cast<int>(left);
+                }
+                events.clear();
+                monitor.poll(events, wait_ms);
+                for (const auto& event : events) {
+                    if (!on_event(event)) {
+                        return;
+                    }
+                }
+            }
+        });
+    }
+
+    status_t Runtime::autoscale(const autoscale_options& opts,
+                                const std::function<bool(const limit_decision&)>& on_decision, int timeout_ms)
+    {
+        return guarded([&]() {
+            if (opts.interval_ms < 10) {
+                throw_error("Controller interval must be at least 10 ms");
+            }
+            if (opts.cpu_budget < 1 || opts.cpu_budget > 100) {
+                throw_error("Cpu budget must be in [1, 100]");
+            }
+            limit_controller controller(root_dir, opts);
+            auto start = monotonic_ms();
+            auto next_step = start;
+            vector<limit_decision> decisions;
+            while (timeout_ms < 0 || next_step - start <= timeout_ms) {
+                decisions.clear();
+                controller.step(decisions);
+                for (const auto& decision : decisions) {
+                    if (!on_decision(decision)) {
+                        return;
+                    }
+                }
+                // steps are not shifted by time they take
+                next_step += opts.interval_ms;
+                auto left = next_step - monotonic_ms();
+                if (left > 0) {
+                    poll(NULL, 0, static_cast<int>(left));
+                }
+            }
+        });
+    }
+
+    string Runtime::log_path(pid_t pid) const
+    {
+        return get_log_path(root_dir, pid);
+    }
+}
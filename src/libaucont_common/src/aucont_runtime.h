@@ -0,0 +1,273 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include "aucont_autoscale.h"
+#include "aucont_common.h"
+#include "aucont_events.h"
+#include "aucont_registry.h"
+
+namespace aucont
+{
+    /**
+     * Result of runtime operation: `code` is 0 on success or errno-like
+     * error code, `msg` describes error
+     */
+    struct status_t
+    {
+        int code;
+        std::string msg;
+
+        status_t(int code = 0, std::string msg = ""): code(code), msg(msg)
+        {}
+
+        bool ok() const
+        {
+            return code == 0;
+        }
+    };
+
+    /**
+     * Container port published on host: connections to any host address at
+     * `host_port` are forwarded to container's `cont_port`
+     */
+    struct port_mapping
+    {
+        uint16_t host_port;
+        uint16_t cont_port;
+        bool udp;
+
+        port_mapping(uint16_t host_port = 0, uint16_t cont_port = 0, bool udp = false)
+        : host_port(host_port), cont_port(cont_port), udp(udp)
+        {}
+    };
+
+    /**
+     * Container start options
+     */
+    struct options
+    {
+        bool daemonize;    // container outlives caller, caller is not expected to wait for it
+        bool rootfs_tmpfs; // copy image into container private tmpfs instead of binding it
+        bool log;          // capture output of daemonized container into log
+        bool init;         // run command under minimal init, which reaps zombies and forwards signals
+        bool exec_agent;   // init also runs commands for `exec` with `agent` option (see aucont_agent.h)
+        bool pressure_events; // container gets its own cgroup v2 for pressure and memory events
+        size_t log_size;   // max size of one log part in bytes
+        int cpu_perc;
+        int cpu_min;       // bounds of adaptive cpu limit (see aucont_autoscale.h), 0 - `cpu_perc` is
+        int cpu_max;       // static limit; otherwise it's initial limit, clamped to bounds
+        uint64_t mem_min;  // bounds of adaptive `memory.high` in bytes, 0 - memory is not limited
+        uint64_t mem_max;
+        std::string ip;
+        uint64_t net_rate;    // container traffic limit (each direction) in bits per second, 0 - unlimited
+        uint64_t net_burst;   // bytes, which may be sent at once above rate, 0 - chosen by rate
+        std::string net_prio; // `interactive`, `normal` or `bulk`: priority (qdisc band) of container's outgoing packets
+        std::vector<port_mapping> ports; // published ports, removed from host when container exits
+        std::string fsimg_path;
+        std::string prewarm_list; // file with image paths to read into page cache on start
+        std::string ready_probe;  // how workload reports readiness (see aucont_ready.h), empty - it doesn't
+        std::vector<std::string> args; // command to run in container and its arguments
+
+        options(): daemonize(false), rootfs_tmpfs(false), log(false), init(false), exec_agent(false),
+                   pressure_events(false), log_size(1024 * 1024), cpu_perc(100),
+                   cpu_min(0), cpu_max(0), mem_min(0), mem_max(0), net_rate(0), net_burst(0), net_prio("normal")
+        {}
+    };
+
+    /**
+     * Started container. Init process of not daemonized container is a child
+     * of caller, which must be reaped with `Runtime::wait`
+     */
+    struct container_handle
+    {
+        pid_t pid;  // container init process pid (as seen from host)
+        int pidfd;  // pidfd of container init process, owned by handle
+        bool child; // init is a child of caller (container is not daemonized)
+        int ready_fd; // aucont end of `notify` readiness socket until readiness is awaited, -1 otherwise
+
+        container_handle(): pid(-1), pidfd(-1), child(false), ready_fd(-1)
+        {}
+    };
+
+    /**
+     * Options for command execution in container; -1 fd means fd is inherited from caller
+     */
+    struct exec_options
+    {
+        int stdin_fd;
+        int stdout_fd;
+        int stderr_fd;
+        bool new_pgroup; // run command in own process group (to kill it with all helpers)
+        bool agent;      // run command by exec agent of container instead of joining its namespaces
+
+        exec_options(): stdin_fd(-1), stdout_fd(-1), stderr_fd(-1), new_pgroup(false), agent(false)
+        {}
+    };
+
+    /**
+     * Command running in container; `pid` is a child of caller, reaped with `Runtime::wait_exec`.
+     * Command run by exec agent has no pid and pidfd (-1), its exit code comes through `agent_fd`
+     */
+    struct exec_handle
+    {
+        pid_t pid;
+        int pidfd;
+        int agent_fd;
+
+        exec_handle(): pid(-1), pidfd(-1), agent_fd(-1)
+        {}
+    };
+
+    /**
+     * Container checkpoint options (see aucont_checkpoint.h)
+     */
+    struct checkpoint_options
+    {
+        int pre_dumps;      // incremental memory pre-dumps before final dump, while container runs
+        bool leave_running; // container keeps running after dump (warm template), otherwise it's killed
+        std::string name;   // snapshot name, empty - `<pid>-<unix time>`
+
+        checkpoint_options(): pre_dumps(0), leave_running(false)
+        {}
+    };
+
+    struct container_stats
+    {
+        size_t procs;         // number of processes in container
+        uint64_t cpu_time_ms; // user + system cpu time of running processes
+        uint64_t rss_bytes;   // sum of resident set sizes of processes
+        bool paused;
+    };
+
+    /**
+     * Embeddable container runtime. Holds no global state: every runtime works
+     * with its own root dir (registry, cgroup hierarchies, logs and helper scripts)
+     * and is safe to use from several threads at once. Methods never exit or
+     * print, errors are reported with returned status
+     */
+    class Runtime
+    {
+    public:
+        /**
+         * @param root_dir directory with aucont helper scripts, where runtime keeps its state
+         */
+        explicit Runtime(std::string root_dir);
+
+        /**
+         * Starts container and returns when it is configured and command is being executed
+         */
+        status_t start(const options& opts, container_handle& handle);
+
+        /**
+         * Waits for container to exit and reaps its init if it is caller's child.
+         * Returns ETIMEDOUT status if container is still running after `timeout_ms`
+         * (-1 to wait forever), handle stays valid then
+         * @param exit_code container init exit code (128 + signal for killed one) if not null;
+         *                  -1 for daemonized container
+         */
+        status_t wait(container_handle& handle, int timeout_ms, int* exit_code = nullptr);
+
+        /**
+         * Waits for workload of container, started with `opts.ready_probe`, to
+         * become ready (see aucont_ready.h) and records result in registry.
+         * Returns ETIMEDOUT status if it isn't ready after `timeout_ms` (-1 to
+         * wait forever) and ECHILD status if container exits before it
+         */
+        status_t wait_ready(container_handle& handle, const options& opts, int timeout_ms);
+
+        /**
+         * Runs command (args[0]) inside running container
+         */
+        status_t exec(const container_t& cont, const std::vector<std::string>& args,
+                      const exec_options& exec_opts, exec_handle& handle);
+
+        /**
+         * Waits for command started with `exec`, semantics is the same as for `wait`
+         */
+        status_t wait_exec(exec_handle& handle, int timeout_ms, int& exit_code);
+
+        /**
+         * Sends signal to containers. With `timeout_ms` >= 0 waits for them to exit,
+         * containers still running after timeout are killed with SIGKILL (their
+         * pids are added to `killed` if it is not null) and removed from registry
+         * together with dead ones. Not running containers are skipped
+         */
+        status_t stop(const std::vector<pid_t>& pids, int signum, int timeout_ms,
+                      std::vector<pid_t>* killed = nullptr);
+
+        /**
+         * Removes dead containers from registry and releases host objects they
+         * left (see `release_containers`). Start, wait and stop (even with no
+         * containers to stop) do it too; reading methods (`list`, `get`,
+         * `watch`, ...) never change registry
+         * @param pruned pids of removed containers are added there if it is not null
+         */
+        status_t prune(std::vector<pid_t>* pruned = nullptr);
+
+        status_t list(std::vector<container_t>& conts);
+
+        /**
+         * Returns ESRCH status if there is no running container with given pid
+         */
+        status_t get(pid_t pid, container_t& cont);
+
+        status_t stats(pid_t pid, container_stats& stats);
+
+        /**
+         * Freezes all processes of container (see aucont_freezer.h)
+         */
+        status_t pause(pid_t pid);
+
+        status_t resume(pid_t pid);
+
+        /**
+         * Checkpoints container with CRIU into snapshot in memory backed
+         * snapshots dir (see aucont_checkpoint.h). Returns EBUSY status for
+         * paused container and ENOTSUP status for container with exec agent
+         * @param snapshot path of snapshot, which is given to `restore`
+         */
+        status_t checkpoint(pid_t pid, const checkpoint_options& opts, std::string& snapshot);
+
+        /**
+         * Restores container from snapshot (path or name) as new daemonized
+         * container with its network, cgroups and log recreated, and registers it
+         */
+        status_t restore(const std::string& snapshot, container_handle& handle);
+
+        /**
+         * Streams container events (see aucont_events.h) to `on_event`, starting
+         * with `running` event for every running container, until `on_event`
+         * returns false or `timeout_ms` passes (-1 to watch forever)
+         */
+        status_t watch(const std::function<bool(const event_t&)>& on_event, int timeout_ms = -1);
+
+        /**
+         * Runs adaptive limits controller (see aucont_autoscale.h): revises limits
+         * every `opts.interval_ms` and passes every change to `on_decision` until
+         * it returns false or `timeout_ms` passes (-1 to run forever)
+         */
+        status_t autoscale(const autoscale_options& opts,
+                           const std::function<bool(const limit_decision&)>& on_decision, int timeout_ms = -1);
+
+        /**
+         * returns path to log of container started with `log` option
+         */
+        std::string log_path(pid_t pid) const;
+
+        const std::string& root() const
+        {
+            return root_dir;
+        }
+
+    private:
+        std::string root_dir;
+        registry reg;
+    };
+}
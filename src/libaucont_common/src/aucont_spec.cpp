@@ -0,0 +1,147 @@
+#include "aucont_spec.h"
+#include "aucont_common.h"
+
+#include <fstream>
+#include <sstream>
+
+#include <cerrno>
+
+#include <sys/stat.h>
+
+namespace aucont
+{
+    using std::string;
+
+    namespace
+    {
+        string bool_value(bool value)
+        {
+            return value ? "1" : "0";
+        }
+
+        string ports_value(const std::vector<port_mapping>& ports)
+        {
+            std::stringstream ss;
+            for (const auto& port : ports) {
+                ss << (ss.tellp() > 0 ? " " : "") << port.host_port << ":" << port.cont_port
+                   << (port.udp ? "/udp" : "/tcp");
+            }
+            return ss.str();
+        }
+
+        std::vector<port_mapping> parse_ports(const string& value)
+        {
+            std::vector<port_mapping> ports;
+            std::stringstream ss(value);
+            string item;
+            while (ss >> item) {
+                auto colon = item.find(':');
+                auto slash = item.find('/');
+                if (colon == string::npos || slash == string::npos) {
+                    throw_error("Bad port mapping in container spec [ " + item + " ]");
+                }
+                ports.push_back(port_mapping(std::stoi(item.substr(0, colon)),
+                                             std::stoi(item.substr(colon + 1, slash - colon - 1)),
+                                             item.substr(slash + 1) == "udp"));
+            }
+            return ports;
+        }
+    }
+
+    string get_spec_path(const string& root_dir, pid_t cont_pid)
+    {
+        return root_dir + "/specs/" + std::to_string(cont_pid);
+    }
+
+    void save_spec(const string& path, const container_spec& spec, const std::map<string, string>& extra)
+    {
+        const auto& opts = spec.opts;
+        std::map<string, string> values = {
+            { "fsimg_path", opts.fsimg_path },
+            { "rootfs_tmpfs", bool_value(opts.rootfs_tmpfs) },
+            { "log", bool_value(opts.log) },
+            { "log_size", std::to_string(opts.log_size) },
+            { "init", bool_value(opts.init) },
+            { "exec_agent", bool_value(opts.exec_agent) },
+            { "pressure_events", bool_value(opts.pressure_events) },
+            { "cpu_perc", std::to_string(opts.cpu_perc) },
+            { "cpu_min", std::to_string(opts.cpu_min) },
+            { "cpu_max", std::to_string(opts.cpu_max) },
+            { "mem_min", std::to_string(opts.mem_min) },
+            { "mem_max", std::to_string(opts.mem_max) },
+            { "ip", opts.ip },
+            { "net_rate", std::to_string(opts.net_rate) },
+            { "net_burst", std::to_string(opts.net_burst) },
+            { "net_prio", opts.net_prio },
+            { "ports", ports_value(opts.ports) },
+            { "cont_veth", spec.cont_veth },
+        };
+        values.insert(extra.begin(), extra.end());
+
+        const string dir = path.substr(0, path.find_last_of('/'));
+        if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+            throw_stdlib_error("Can't create directory [ " + dir + " ]");
+        }
+        std::ofstream out(path, std::ios_base::trunc);
+        for (const auto& value : values) {
+            if (value.second.find('\n') != string::npos) {
+                throw_error("Container spec value can't contain new line [ " + value.first + " ]");
+            }
+            out << value.first << "=" << value.second << "\n";
+        }
+        out.close();
+        if (out.fail()) {
+            throw_error("Can't write container spec [ " + path + " ]");
+        }
+    }
+
+    container_spec load_spec(const string& path, std::map<string, string>* values)
+    {
+        std::ifstream in(path);
+        if (!in) {
+            throw_error("Can't read container spec [ " + path + " ]", ENOENT);
+        }
+        std::map<string, string> read;
+        string line;
+        while (std::getline(in, line)) {
+            auto eq = line.find('=');
+            if (eq != string::npos) {
+                read[line.substr(0, eq)] = line.substr(eq + 1);
+            }
+        }
+        if (read.count("fsimg_path") == 0) {
+            throw_error("Container spec is incomplete [ " + path + " ]");
+        }
+
+        container_spec spec;
+        auto& opts = spec.opts;
+        try {
+            opts.fsimg_path = read["fsimg_path"];
+            opts.rootfs_tmpfs = read["rootfs_tmpfs"] == "1";
+            opts.log = read["log"] == "1";
+            opts.log_size = std::stoull(read["log_size"]);
+            opts.init = read["init"] == "1";
+            opts.exec_agent = read["exec_agent"] == "1";
+            opts.pressure_events = read["pressure_events"] == "1";
+            opts.cpu_perc = std::stoi(read["cpu_perc"]);
+            opts.cpu_min = std::stoi(read["cpu_min"]);
+            opts.cpu_max = std::stoi(read["cpu_max"]);
+            opts.mem_min = std::stoull(read["mem_min"]);
+            opts.mem_max = std::stoull(read["mem_max"]);
+            opts.ip = read["ip"];
+            opts.net_rate = std::stoull(read["net_rate"]);
+            opts.net_burst = std::stoull(read["net_burst"]);
+            opts.net_prio = read["net_prio"];
+            opts.ports = parse_ports(read["ports"]);
+        } catch (const std::logic_error&) {
+            throw_error("Bad value in container spec [ " + path + " ]");
+        }
+        spec.cont_veth = read["cont_veth"];
+        // restored container is always detached from caller
+        opts.daemonize = true;
+        if (values != nullptr) {
+            *values = read;
+        }
+        return spec;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <sys/types.h>
+
+#include "aucont_runtime.h"
+
+namespace aucont
+{
+    /**
+     * Configuration of running container, which can't be read back from it:
+     * start options (command is not kept) and name of its veth end inside
+     * container (veth keeps name of container it was created for, when
+     * container is restored from checkpoint). Kept in `root_dir/specs/<pid>`
+     * while container runs, so it can be checkpointed and restored later
+     */
+    struct container_spec
+    {
+        options opts;
+        std::string cont_veth; // empty without network
+    };
+
+    /**
+     * returns path of spec file of container
+     */
+    std::string get_spec_path(const std::string& root_dir, pid_t cont_pid);
+
+    /**
+     * Writes spec as `key=value` lines, `extra` values are added after spec
+     * ones. Throws aucont_error on failure
+     */
+    void save_spec(const std::string& path, const container_spec& spec,
+                   const std::map<std::string, std::string>& extra = std::map<std::string, std::string>());
+
+    /**
+     * Reads spec written by `save_spec`. Throws aucont_error on failure
+     * (ENOENT if there is no such file)
+     * @param values all values of file (with extra ones) if not null
+     */
+    container_spec load_spec(const std::string& path, std::map<std::string, std::string>* values = nullptr);
+}
@@ -2,16 +2,28 @@ import subprocess
 import os
 import sys
 import itertools
+import json
+import queue
+import threading
 
 import test_utils as util
 
-# returns container pid on success
+# returns container pid on success; with ready_probe or wait_ready (True or
+# timeout in seconds) returns when workload is ready
 # throws on error
 def start_daemonized(image_path, *cmd_and_args,
-    cpu_perc=None, cont_ip=None):
+    cpu_perc=None, cont_ip=None, prewarm=None, rootfs_mode=None,
+    log=False, init=False, net_rate=None, net_burst=None, net_prio=None,
+    ports=(), cpu_range=None, mem_range=None, ready_probe=None, wait_ready=None,
+    exec_agent=False):
     cont_start_cmd_and_args = _make_cont_start_cmd(
         False, image_path, cmd_and_args,
-        cpu_perc=cpu_perc, cont_ip=cont_ip
+        cpu_perc=cpu_perc, cont_ip=cont_ip,
+        prewarm=prewarm, rootfs_mode=rootfs_mode, log=log, init=init,
+        exec_agent=exec_agent,
+        net_rate=net_rate, net_burst=net_burst, net_prio=net_prio,
+        ports=ports, cpu_range=cpu_range, mem_range=mem_range,
+        ready_probe=ready_probe, wait_ready=wait_ready
     )
     
     output = subprocess.check_output(cont_start_cmd_and_args)
@@ -32,23 +44,37 @@ def start_interactive(image_path, *cmd_and_args,
         stdin=sys.stdin, stdout=sys.stdout, stderr=sys.stderr
     )
 
+# runs command in not daemonized container, recording image files it maps
+# into prewarm list file; blocks until container exits
 # throws on error
-def stop(cont_pid, signal=15):
+def record_prewarm(image_path, list_file, *cmd_and_args):
+    cont_start_cmd_and_args = _make_cont_start_cmd(
+        True, image_path, cmd_and_args, prewarm_record=list_file
+    )
+    subprocess.check_call(cont_start_cmd_and_args, stdout=subprocess.DEVNULL)
+
+# cont_pid may be single pid, list of pids or '--all';
+# with timeout waits for containers to exit, killing them after timeout
+# throws on error
+def stop(cont_pid, signal=15, timeout=None):
     signal = str(signal)
-    cont_stop_cmd_and_args = [
-        util.aucont_tool_path('aucont_stop'),
-        cont_pid,
-        signal
-    ]
+    if isinstance(cont_pid, list):
+        cont_pid = ','.join(cont_pid)
+    cont_stop_cmd_and_args = [util.aucont_tool_path('aucont_stop')]
+    if timeout is not None:
+        cont_stop_cmd_and_args.extend(['--timeout', str(timeout)])
+    cont_stop_cmd_and_args.extend([cont_pid, signal])
     util.debug(*cont_stop_cmd_and_args)
     subprocess.check_call(cont_stop_cmd_and_args)
     util.log('stopped container', cont_pid);
 
 # starts container, runs command, captures output and returns it
 # throws on error
-def run_cmd(image_path, *cmd_and_args, cpu_perc=None, cont_ip=None):
+def run_cmd(image_path, *cmd_and_args, cpu_perc=None, cont_ip=None,
+    prewarm=None, rootfs_mode=None):
     cont_pid = start_daemonized(image_path, '/bin/sleep', '1000000',
-        cpu_perc=cpu_perc, cont_ip=cont_ip)
+        cpu_perc=cpu_perc, cont_ip=cont_ip,
+        prewarm=prewarm, rootfs_mode=rootfs_mode)
     output = exec_capture_output(cont_pid, *cmd_and_args)
     stop(cont_pid, 9)
     return output
@@ -67,13 +93,14 @@ def exec_interactive(cont_pid, *cmd_and_args):
         stdin=sys.stdin, stdout=sys.stdout, stderr=sys.stderr
     )
 
-# blocks until interactive session was finished
+# runs command in container and returns its output; with fast=True command
+# is run by exec agent of container (started with exec_agent=True)
 # throws on error
-def exec_capture_output(cont_pid, *cmd_and_args):
-    cont_exec_cmd_and_args = [
-        util.aucont_tool_path('aucont_exec'),
-        cont_pid
-    ]
+def exec_capture_output(cont_pid, *cmd_and_args, fast=False):
+    cont_exec_cmd_and_args = [util.aucont_tool_path('aucont_exec')]
+    if fast:
+        cont_exec_cmd_and_args.append('--fast')
+    cont_exec_cmd_and_args.append(cont_pid)
     cont_exec_cmd_and_args += cmd_and_args
     util.debug(*cont_exec_cmd_and_args)
 
@@ -86,25 +113,271 @@ def exec_capture_output(cont_pid, *cmd_and_args):
         raise
     return output.decode('UTF-8')
 
+# runs command in several containers at once, targets is a list of
+# container pids or '--all'; returns captured output and exit code
+def exec_fanout(targets, *cmd_and_args, parallelism=None, timeout=None):
+    cont_exec_cmd_and_args = [util.aucont_tool_path('aucont_exec')]
+    if parallelism:
+        cont_exec_cmd_and_args.extend(['-j', str(parallelism)])
+    if timeout:
+        cont_exec_cmd_and_args.extend(['--timeout', str(timeout)])
+    if targets == '--all':
+        cont_exec_cmd_and_args.append('--all')
+    else:
+        cont_exec_cmd_and_args.append(','.join(targets))
+    cont_exec_cmd_and_args += cmd_and_args
+    util.debug(*cont_exec_cmd_and_args)
+
+    proc = subprocess.run(cont_exec_cmd_and_args,
+        stdout=subprocess.PIPE, stderr=subprocess.STDOUT
+    )
+    return proc.stdout.decode('UTF-8'), proc.returncode
+
+# returns captured output of container started with log=True
+# throws on error
+def logs(cont_pid, follow=False):
+    cont_logs_cmd_and_args = [
+        util.aucont_tool_path('aucont_logs'),
+        cont_pid
+    ]
+    if follow: cont_logs_cmd_and_args.append('--follow')
+    util.debug(*cont_logs_cmd_and_args)
+    output = subprocess.check_output(cont_logs_cmd_and_args)
+    return output.decode('UTF-8')
+
 # returns list of started and not stopped container pids
 # throws on error
 def clist():
+    return [line.split()[0] for line in clist_lines()]
+
+# returns aucont_list output lines: pid and optional state (`paused`)
+# throws on error
+def clist_lines():
     cont_list_cmd_and_args = [
         util.aucont_tool_path('aucont_list')
     ]
     output = subprocess.check_output(cont_list_cmd_and_args)
-    pids = output.decode('UTF-8').split('\n')
-    pids = list(filter(lambda pid: pid != '', pids))
-    util.debug(pids)
-    return pids
+    lines = output.decode('UTF-8').split('\n')
+    lines = list(filter(lambda line: line != '', lines))
+    util.debug(lines)
+    return lines
+
+# throws on error
+def pause(cont_pid):
+    cont_pause_cmd_and_args = [
+        util.aucont_tool_path('aucont_pause'),
+        cont_pid
+    ]
+    util.debug(*cont_pause_cmd_and_args)
+    subprocess.check_call(cont_pause_cmd_and_args)
+    util.log('paused container', cont_pid)
+
+# throws on error
+def resume(cont_pid):
+    cont_resume_cmd_and_args = [
+        util.aucont_tool_path('aucont_resume'),
+        cont_pid
+    ]
+    util.debug(*cont_resume_cmd_and_args)
+    subprocess.check_call(cont_resume_cmd_and_args)
+    util.log('resumed container', cont_pid)
+
+# throws on error, returns snapshot path
+def checkpoint(cont_pid, pre_dumps=None, leave_running=False, name=None):
+    cont_checkpoint_cmd_and_args = [util.aucont_tool_path('aucont_checkpoint')]
+    if pre_dumps is not None:
+        cont_checkpoint_cmd_and_args += ['--pre-dumps', str(pre_dumps)]
+    if leave_running:
+        cont_checkpoint_cmd_and_args.append('--leave-running')
+    if name is not None:
+        cont_checkpoint_cmd_and_args += ['--name', name]
+    cont_checkpoint_cmd_and_args.append(cont_pid)
+    util.debug(*cont_checkpoint_cmd_and_args)
+    snapshot = subprocess.check_output(cont_checkpoint_cmd_and_args).decode('UTF-8').strip()
+    util.log('checkpointed container', cont_pid, 'to', snapshot)
+    return snapshot
+
+# throws on error, returns pid of restored container
+def restore(snapshot):
+    cont_restore_cmd_and_args = [
+        util.aucont_tool_path('aucont_restore'),
+        snapshot
+    ]
+    util.debug(*cont_restore_cmd_and_args)
+    cont_pid = subprocess.check_output(cont_restore_cmd_and_args).decode('UTF-8').strip()
+    util.log('restored container', cont_pid, 'from', snapshot)
+    return cont_pid
+
+# starts adaptive limits controller `aucont_autoscale` in background,
+# stop it with proc.kill(); its decision log is proc.stdout
+def start_autoscale(interval_ms=None, cpu_budget=None, mem_budget_mb=None):
+    cont_autoscale_cmd_and_args = [util.aucont_tool_path('aucont_autoscale')]
+    if interval_ms:
+        cont_autoscale_cmd_and_args.extend(['--interval', str(interval_ms)])
+    if cpu_budget:
+        cont_autoscale_cmd_and_args.extend(['--cpu-budget', str(cpu_budget)])
+    if mem_budget_mb:
+        cont_autoscale_cmd_and_args.extend(['--mem-budget', str(mem_budget_mb)])
+    util.debug(*cont_autoscale_cmd_and_args)
+    return subprocess.Popen(cont_autoscale_cmd_and_args, stdout=subprocess.PIPE)
+
+# starts `aucont_events` (for given containers or for all of them) in
+# background; its events are read with next_event, stream is stopped with
+# proc.kill()
+def watch_events(*cont_pids):
+    cont_events_cmd_and_args = [util.aucont_tool_path('aucont_events')]
+    if cont_pids:
+        cont_events_cmd_and_args.append(','.join(cont_pids))
+    util.debug(*cont_events_cmd_and_args)
+    proc = subprocess.Popen(cont_events_cmd_and_args, stdout=subprocess.PIPE)
+    proc.events = queue.Queue()
+    def read_events():
+        for line in proc.stdout:
+            proc.events.put(json.loads(line.decode('UTF-8')))
+    threading.Thread(target=read_events, daemon=True).start()
+    return proc
+
+# returns next event (dict) of stream started with watch_events, skipping
+# events of other types if event_type is given
+# throws if there is no such event in `timeout` seconds
+def next_event(proc, event_type=None, timeout=5):
+    while True:
+        try:
+            event = proc.events.get(timeout=timeout)
+        except queue.Empty:
+            raise Exception('no {} event in {} seconds'.format(event_type or 'any', timeout))
+        util.debug(event)
+        if event_type is None or event['event'] == event_type:
+            return event
+
+_NET_RECEIVER = """
+import socket, sys, time
+srv = socket.socket()
+srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+srv.bind(('0.0.0.0', int(sys.argv[1])))
+srv.listen(1)
+print('ready', flush=True)
+conn, _ = srv.accept()
+total = 0
+start = None
+while True:
+    data = conn.recv(1 << 16)
+    if not data:
+        break
+    if start is None:
+        start = time.monotonic()
+    total += len(data)
+print(total, time.monotonic() - start, flush=True)
+"""
+
+_NET_SENDER = """
+import socket, sys, time
+conn = socket.create_connection((sys.argv[1], int(sys.argv[2])))
+chunk = b'x' * (1 << 16)
+deadline = time.monotonic() + float(sys.argv[3])
+while time.monotonic() < deadline:
+    conn.sendall(chunk)
+conn.close()
+"""
+
+_NET_ECHO_SERVER = """
+import socket, sys
+srv = socket.socket()
+srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+srv.bind(('0.0.0.0', int(sys.argv[1])))
+srv.listen(1)
+print('ready', flush=True)
+conn, _ = srv.accept()
+conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+while True:
+    data = conn.recv(1)
+    if not data:
+        break
+    conn.sendall(data)
+print('done', 0, flush=True)
+"""
+
+_NET_ECHO_CLIENT = """
+import socket, sys, time
+conn = socket.create_connection((sys.argv[1], int(sys.argv[2])))
+conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+rounds = int(sys.argv[3])
+start = time.monotonic()
+for i in range(rounds):
+    conn.sendall(b'x')
+    conn.recv(1)
+print((time.monotonic() - start) / rounds, flush=True)
+conn.close()
+"""
+
+# runs server python code in network namespace of container dst_pid and
+# client code in namespace of container src_pid (both are host processes,
+# so image doesn't need any network tools); returns last output lines of
+# server and client
+# throws on error
+def _net_run(server, client, src_pid, dst_pid, dst_ip, port, dst_port, arg):
+    receiver = subprocess.Popen(
+        ['sudo', 'nsenter', '-t', dst_pid, '-n',
+         sys.executable, '-c', server, str(port)],
+        stdout=subprocess.PIPE
+    )
+    try:
+        util.check(receiver.stdout.readline().strip() == b'ready',
+            'network server failed')
+        client_out = subprocess.check_output(
+            ['sudo', 'nsenter', '-t', src_pid, '-n', sys.executable, '-c',
+             client, dst_ip, str(dst_port or port), str(arg)]
+        )
+        server_out = receiver.stdout.readline()
+    finally:
+        receiver.kill()
+        receiver.wait()
+    return server_out.decode('UTF-8').split(), client_out.decode('UTF-8').split()
+
+# returns TCP throughput (bits per second) from container src_pid to
+# container dst_pid, which listens on `port`; sender connects to
+# dst_ip:dst_port (`port` by default), which may be published host port
+# throws on error
+def net_throughput(src_pid, dst_pid, dst_ip, seconds=2, port=5001, dst_port=None):
+    (total, elapsed), _ = _net_run(_NET_RECEIVER, _NET_SENDER,
+        src_pid, dst_pid, dst_ip, port, dst_port, seconds)
+    return int(total) * 8 / float(elapsed)
+
+# returns average TCP round trip time (seconds) of 1 byte ping-pong between
+# containers, arguments are the same as for net_throughput
+# throws on error
+def net_latency(src_pid, dst_pid, dst_ip, rounds=10000, port=5001, dst_port=None):
+    _, (rtt,) = _net_run(_NET_ECHO_SERVER, _NET_ECHO_CLIENT,
+        src_pid, dst_pid, dst_ip, port, dst_port, rounds)
+    return float(rtt)
 
 def _make_cont_start_cmd(is_interactive, image_path, cmd_and_args,
-    cpu_perc=None, cont_ip=None):
+    cpu_perc=None, cont_ip=None, prewarm=None, rootfs_mode=None,
+    log=False, init=False, net_rate=None, net_burst=None, net_prio=None,
+    ports=(), cpu_range=None, mem_range=None, ready_probe=None, wait_ready=None,
+    exec_agent=False, prewarm_record=None):
     cont_start_opts_list = []
     if not is_interactive: cont_start_opts_list.append('-d')
+    if init: cont_start_opts_list.append('--init')
+    if exec_agent: cont_start_opts_list.append('--exec-agent')
+    if log: cont_start_opts_list.append('--log')
     if cpu_perc:
         cont_start_opts_list.extend(['--cpu', str(cpu_perc)])
+    if cpu_range: cont_start_opts_list.extend(['--cpu-range', cpu_range])
+    if mem_range: cont_start_opts_list.extend(['--mem-range', mem_range])
     if cont_ip: cont_start_opts_list.extend(['--net', cont_ip])
+    if net_rate: cont_start_opts_list.extend(['--net-rate', str(net_rate)])
+    if net_burst: cont_start_opts_list.extend(['--net-burst', str(net_burst)])
+    if net_prio: cont_start_opts_list.extend(['--net-prio', net_prio])
+    for port in ports: cont_start_opts_list.extend(['-p', port])
+    if ready_probe: cont_start_opts_list.extend(['--ready-probe', ready_probe])
+    if wait_ready is True: cont_start_opts_list.append('--wait-ready')
+    elif wait_ready: cont_start_opts_list.append('--wait-ready=' + str(wait_ready))
+    if prewarm: cont_start_opts_list.extend(['--prewarm', prewarm])
+    if prewarm_record:
+        cont_start_opts_list.extend(['--prewarm-record', prewarm_record])
+    if rootfs_mode:
+        cont_start_opts_list.extend(['--rootfs-mode', rootfs_mode])
 
     cont_start_cmd_and_arg_lists = [
         [util.aucont_tool_path('aucont_start')],
@@ -0,0 +1,73 @@
+#!/usr/bin/python3
+
+# Compares cold start of container with slow warmup (busy loop of WARMUP_ITERS
+# iterations, which stands for cache filling or JIT) and restore of the same
+# container from snapshot taken when it's warm: time until container is useful
+# (warmup is over and exec into it works) for both, and time of checkpoint
+# itself with PRE_DUMPS pre-dumps. Restored container must keep warm state
+# (its counter), otherwise restore is counted as failed.
+#
+# usage: ./bench_checkpoint.py [RUNS_NUM] [WARMUP_ITERS] [PRE_DUMPS]
+
+import os
+import sys
+import time
+import shutil
+import statistics
+
+import test_utils as util
+import aucont
+
+POLL_INTERVAL = 0.01
+
+def workload(warmup_iters):
+    return ('i=0; while [ $i -lt {0} ]; do i=$((i+1)); done; '
+            'while true; do echo $i; sleep 0.1; done').format(warmup_iters)
+
+def wait_warm(cont_pid, warmup_iters):
+    while str(warmup_iters) not in aucont.logs(cont_pid).split():
+        time.sleep(POLL_INTERVAL)
+    aucont.exec_capture_output(cont_pid, '/bin/hostname')
+
+def cold_start_ms(warmup_iters):
+    start = time.perf_counter()
+    cont_pid = aucont.start_daemonized(util.test_rootfs_path(),
+        '/bin/sh', '-c', workload(warmup_iters), log=True)
+    wait_warm(cont_pid, warmup_iters)
+    return cont_pid, (time.perf_counter() - start) * 1000
+
+def checkpoint_ms(cont_pid, pre_dumps):
+    start = time.perf_counter()
+    snapshot = aucont.checkpoint(cont_pid, pre_dumps=pre_dumps)
+    return snapshot, (time.perf_counter() - start) * 1000
+
+def restore_ms(snapshot, warmup_iters):
+    start = time.perf_counter()
+    cont_pid = aucont.restore(snapshot)
+    wait_warm(cont_pid, warmup_iters)
+    return cont_pid, (time.perf_counter() - start) * 1000
+
+def main():
+    runs_num = int(sys.argv[1]) if len(sys.argv) > 1 else 10
+    warmup_iters = int(sys.argv[2]) if len(sys.argv) > 2 else 1000000
+    pre_dumps = int(sys.argv[3]) if len(sys.argv) > 3 else 1
+    util.LOG_LEVEL = util.LL_INFO
+    if shutil.which('criu') is None and not os.path.exists('/usr/sbin/criu'):
+        sys.exit('criu is not installed, nothing to measure')
+    results = { 'cold start + warmup': [], 'checkpoint': [], 'restore': [] }
+    for i in range(runs_num):
+        cont_pid, latency = cold_start_ms(warmup_iters)
+        results['cold start + warmup'].append(latency)
+        snapshot, latency = checkpoint_ms(cont_pid, pre_dumps)
+        results['checkpoint'].append(latency)
+        cont_pid, latency = restore_ms(snapshot, warmup_iters)
+        results['restore'].append(latency)
+        aucont.stop(cont_pid, 9, timeout=10)
+    for name, latencies in results.items():
+        util.log('{}: median {:.0f} ms, max {:.0f} ms'.format(
+            name, statistics.median(latencies), max(latencies)))
+    util.log('restore is {:.1f}x faster than cold start'.format(
+        statistics.median(results['cold start + warmup']) / statistics.median(results['restore'])))
+
+if __name__ == '__main__':
+    main()
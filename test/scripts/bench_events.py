@@ -0,0 +1,81 @@
+#!/usr/bin/python3
+
+# Measures how fast container exits are noticed: `aucont_events` stream
+# against polling `aucont_list` once a second (what monitoring did before).
+# Foreground containers are killed one by one and time from kill to exit
+# event is reported; stream cpu time is reported for idle period with
+# CONTS_NUM running containers, polling cost is cpu time of one `aucont_list`.
+#
+# usage: ./bench_events.py [RUNS_NUM] [CONTS_NUM]
+
+import os
+import sys
+import time
+import signal
+import resource
+import statistics
+import subprocess
+
+import test_utils as util
+import aucont
+
+def proc_cpu_ms(pid):
+    with open('/proc/{}/stat'.format(pid)) as stat:
+        fields = stat.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) * 1000 / os.sysconf('SC_CLK_TCK')
+
+def exit_latencies_ms(events, runs_num):
+    latencies = []
+    for i in range(runs_num):
+        # init of foreground container is reaped right away, exit code is known,
+        # unless kernel can't report it (see test_events)
+        start = subprocess.Popen([util.aucont_tool_path('aucont_start'),
+            util.test_rootfs_path(), '/bin/sleep', '1000'], stdout=subprocess.DEVNULL)
+        cont_pid = aucont.next_event(events, 'start')['pid']
+        time.sleep(0.1) # aucont_start is done with container setup
+        killed = time.perf_counter()
+        os.kill(cont_pid, signal.SIGKILL)
+        event = aucont.next_event(events, 'exit')
+        latencies.append((time.perf_counter() - killed) * 1000)
+        util.check(event['pid'] == cont_pid and event['code'] in (137, None))
+        start.wait()
+    return latencies
+
+def list_cpu_ms(runs_num):
+    before = resource.getrusage(resource.RUSAGE_CHILDREN)
+    for i in range(runs_num):
+        aucont.clist()
+    after = resource.getrusage(resource.RUSAGE_CHILDREN)
+    used = (after.ru_utime - before.ru_utime) + (after.ru_stime - before.ru_stime)
+    return used * 1000 / runs_num
+
+def main():
+    runs_num = int(sys.argv[1]) if len(sys.argv) > 1 else 50
+    conts_num = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+    util.LOG_LEVEL = util.LL_INFO
+
+    events = aucont.watch_events()
+    conts = []
+    try:
+        latencies = exit_latencies_ms(events, runs_num)
+        util.log('exit event after kill: median {:.2f} ms, max {:.2f} ms'.format(
+            statistics.median(latencies), max(latencies)))
+        util.log('polling aucont_list every 1 s: 500 ms on average, up to 1000 ms')
+
+        for i in range(conts_num):
+            conts.append(aucont.start_daemonized(util.test_rootfs_path(), '/bin/sleep', '1000'))
+        idle_seconds = 5
+        before = proc_cpu_ms(events.pid)
+        time.sleep(idle_seconds)
+        util.log('stream cpu time with {} idle containers: {:.1f} ms per second'.format(
+            conts_num, (proc_cpu_ms(events.pid) - before) / idle_seconds))
+        util.log('aucont_list cpu time with {} containers: {:.1f} ms per poll'.format(
+            conts_num, list_cpu_ms(20)))
+    finally:
+        events.kill()
+        events.wait()
+        if conts:
+            aucont.stop(conts, 9, timeout=10)
+
+if __name__ == '__main__':
+    main()
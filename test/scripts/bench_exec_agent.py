@@ -0,0 +1,91 @@
+#!/usr/bin/python3
+
+# Compares command execution in container through exec agent (`aucont_exec
+# --fast`) with setns path of plain `aucont_exec`: latency (median, p99) of
+# sequential runs and rate of WORKERS clients running commands at once.
+# Agent is also measured with in-process client (protocol of aucont_agent.h
+# spoken right here), which is what embedding programs get without starting
+# aucont_exec per command.
+#
+# usage: ./bench_exec_agent.py [RUNS_NUM] [WORKERS]
+
+import os
+import sys
+import time
+import socket
+import struct
+import statistics
+import subprocess
+import threading
+
+import test_utils as util
+import aucont
+
+CMD = ['/bin/hostname']
+
+def percentile(values, share):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * share))]
+
+def tool_runner(cont_pid, fast):
+    cmd = [util.aucont_tool_path('aucont_exec')]
+    if fast:
+        cmd.append('--fast')
+    cmd = cmd + [cont_pid] + CMD
+    def run():
+        subprocess.run(cmd, stdout=subprocess.DEVNULL, check=True)
+    return run
+
+def agent_runner(cont_pid):
+    sock_path = os.path.join(os.path.dirname(util.aucont_tool_path('aucont_exec')),
+        'agents', cont_pid + '.sock')
+    request = b''.join(arg.encode() + b'\0' for arg in CMD)
+    devnull = os.open(os.devnull, os.O_RDWR)
+    def run():
+        with socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET) as conn:
+            conn.connect(sock_path)
+            socket.send_fds(conn, [request], [devnull, devnull, devnull])
+            code, = struct.unpack('i', conn.recv(4))
+            util.check(code == 0)
+    return run
+
+def latencies_ms(run, runs_num):
+    latencies = []
+    for i in range(runs_num):
+        start = time.perf_counter()
+        run()
+        latencies.append((time.perf_counter() - start) * 1000)
+    return latencies
+
+def rate(run, runs_num, workers):
+    def worker():
+        for i in range(runs_num // workers):
+            run()
+    threads = [threading.Thread(target=worker) for i in range(workers)]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return (runs_num // workers) * workers / (time.perf_counter() - start)
+
+def main():
+    runs_num = int(sys.argv[1]) if len(sys.argv) > 1 else 500
+    workers = int(sys.argv[2]) if len(sys.argv) > 2 else 8
+    util.LOG_LEVEL = util.LL_INFO
+    cont_pid = aucont.start_daemonized(util.test_rootfs_path(),
+        '/bin/sleep', '1000000', exec_agent=True)
+    try:
+        for name, run in [('aucont_exec (setns)', tool_runner(cont_pid, False)),
+                          ('aucont_exec --fast', tool_runner(cont_pid, True)),
+                          ('agent, in-process client', agent_runner(cont_pid))]:
+            run() # warm up page cache
+            latencies = latencies_ms(run, runs_num)
+            util.log('{}: median {:.2f} ms, p99 {:.2f} ms, {:.0f} execs/s with {} workers'.format(
+                name, statistics.median(latencies), percentile(latencies, 0.99),
+                rate(run, runs_num, workers), workers))
+    finally:
+        aucont.stop(cont_pid, 9, timeout=10)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,49 @@
+#!/usr/bin/python3
+
+# Measures accuracy of `--net-rate`: TCP throughput between two containers,
+# one of them rate limited (traffic in both directions is measured), against
+# configured rate and against unlimited pair of containers.
+#
+# usage: ./bench_net_shaping.py [RATE...] (e.g. 10m 100m, bits per second)
+
+import sys
+
+import test_utils as util
+import aucont
+
+UNITS = {'k': 1000, 'm': 1000 ** 2, 'g': 1000 ** 3}
+
+def rate_bps(rate):
+    if rate[-1] in UNITS:
+        return int(rate[:-1]) * UNITS[rate[-1]]
+    return int(rate)
+
+def bench_pair(name, rate=None, seconds=3):
+    rootfs = util.test_rootfs_path()
+    first = aucont.start_daemonized(rootfs, '/bin/sleep', '1000000',
+        cont_ip='10.0.1.1', net_rate=rate)
+    second = aucont.start_daemonized(rootfs, '/bin/sleep', '1000000',
+        cont_ip='10.0.2.1')
+    try:
+        for direction, src, dst, dst_ip in [
+            ('from container', first, second, '10.0.2.1'),
+            ('to container', second, first, '10.0.1.1')
+        ]:
+            throughput = aucont.net_throughput(src, dst, dst_ip, seconds)
+            line = '{} {}: {:.1f} Mbit/s'.format(name, direction, throughput / 1e6)
+            if rate is not None:
+                line += ' ({:+.1f}% of rate)'.format(
+                    (throughput / rate_bps(rate) - 1) * 100)
+            util.log(line)
+    finally:
+        aucont.stop([first, second], 9, timeout=10)
+
+def main():
+    rates = sys.argv[1:] if len(sys.argv) > 1 else ['10m', '50m', '200m']
+    util.LOG_LEVEL = util.LL_INFO
+    bench_pair('unlimited')
+    for rate in rates:
+        bench_pair('--net-rate ' + rate, rate)
+
+if __name__ == '__main__':
+    main()
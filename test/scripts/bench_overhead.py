@@ -0,0 +1,90 @@
+#!/usr/bin/python3
+
+# Measures host side overhead of running containers: processes, which are
+# left on host (outside of container pid namespaces) for every container,
+# and their resident memory. Container workload itself is not counted.
+#
+# usage: ./bench_overhead.py [CONTAINERS_NUM [ROOTFS_PATH]]
+
+import os
+import sys
+import time
+import subprocess
+
+import test_utils as util
+import aucont
+
+def host_pid_ns():
+    return os.readlink('/proc/self/ns/pid')
+
+# returns {pid: rss_kb} of alive (not zombie) processes in host pid namespace
+def host_procs():
+    host_ns = host_pid_ns()
+    procs = {}
+    for entry in os.listdir('/proc'):
+        if not entry.isdigit():
+            continue
+        try:
+            if os.readlink('/proc/' + entry + '/ns/pid') != host_ns:
+                continue
+            rss_kb = 0
+            zombie = False
+            with open('/proc/' + entry + '/status') as status:
+                for line in status:
+                    if line.startswith('State:'):
+                        zombie = line.split()[1] == 'Z'
+                    elif line.startswith('VmRSS:'):
+                        rss_kb = int(line.split()[1])
+            if not zombie:
+                procs[int(entry)] = rss_kb
+        except OSError:
+            pass # process is gone
+    return procs
+
+def report(mode, conts_num, baseline):
+    helpers = {pid: rss for pid, rss in host_procs().items()
+        if pid not in baseline and pid != os.getpid()}
+    rss_kb = sum(helpers.values())
+    util.log('{}: {} containers, {} host processes ({:.2f} per container), '
+        '{} KB RSS ({:.1f} KB per container)'.format(
+            mode, conts_num, len(helpers), len(helpers) / conts_num,
+            rss_kb, rss_kb / conts_num))
+
+def stop_all():
+    aucont.stop('--all', 9, timeout=10)
+
+def bench_daemonized(rootfs, conts_num, log=False):
+    baseline = host_procs()
+    for i in range(conts_num):
+        aucont.start_daemonized(rootfs, '/bin/sleep', '1000000', log=log)
+    time.sleep(1)
+    report('daemonized' + (' with --log' if log else ''), conts_num, baseline)
+    stop_all()
+
+def bench_foreground(rootfs, conts_num):
+    baseline = host_procs()
+    starters = []
+    with open(os.devnull, 'w') as devnull:
+        for i in range(conts_num):
+            starters.append(subprocess.Popen(
+                [util.aucont_tool_path('aucont_start'), rootfs, '/bin/sleep', '1000000'],
+                stdout=devnull
+            ))
+        while len(aucont.clist()) < conts_num:
+            time.sleep(0.1)
+    time.sleep(1)
+    report('foreground', conts_num, baseline)
+    stop_all()
+    for starter in starters:
+        starter.wait()
+
+def main():
+    conts_num = int(sys.argv[1]) if len(sys.argv) > 1 else 100
+    rootfs = sys.argv[2] if len(sys.argv) > 2 else util.test_rootfs_path()
+    util.LOG_LEVEL = util.LL_INFO
+    bench_daemonized(rootfs, conts_num)
+    bench_daemonized(rootfs, conts_num, log=True)
+    bench_foreground(rootfs, conts_num)
+
+if __name__ == '__main__':
+    main()
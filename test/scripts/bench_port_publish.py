@@ -0,0 +1,37 @@
+#!/usr/bin/python3
+
+# Compares access to container service through published host port (`-p`,
+# kernel DNAT) with direct access to container ip: TCP throughput and round
+# trip time of 1 byte ping-pong from another container.
+#
+# usage: ./bench_port_publish.py [SECONDS [ROUNDS]]
+
+import sys
+
+import test_utils as util
+import aucont
+
+def main():
+    seconds = float(sys.argv[1]) if len(sys.argv) > 1 else 3
+    rounds = int(sys.argv[2]) if len(sys.argv) > 2 else 20000
+    util.LOG_LEVEL = util.LL_INFO
+    rootfs = util.test_rootfs_path()
+    server = aucont.start_daemonized(rootfs, '/bin/sleep', '1000000',
+        cont_ip='10.0.1.1', ports=['8080:5001'])
+    client = aucont.start_daemonized(rootfs, '/bin/sleep', '1000000',
+        cont_ip='10.0.2.1')
+    try:
+        # client's gateway is a host address
+        for name, ip, port in [('direct', '10.0.1.1', 5001),
+                               ('published', '10.0.2.2', 8080)]:
+            throughput = aucont.net_throughput(client, server, ip, seconds,
+                port=5001, dst_port=port)
+            rtt = aucont.net_latency(client, server, ip, rounds,
+                port=5001, dst_port=port)
+            util.log('{} ({}:{}): {:.1f} Mbit/s, {:.1f} us round trip'.format(
+                name, ip, port, throughput / 1e6, rtt * 1e6))
+    finally:
+        aucont.stop([server, client], 9, timeout=10)
+
+if __name__ == '__main__':
+    main()
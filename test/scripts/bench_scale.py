@@ -0,0 +1,182 @@
+#!/usr/bin/python3
+
+# Density test: ramps number of running containers up to MAX_CONTS (every
+# BUSY_EVERY-th of them spins on cpu, limited to 1%, others sleep) and at each
+# level measures, with PROBES sequential runs, latency of start and stop of
+# one more container, of exec into running one and of aucont_list, together
+# with host memory, open files, processes and per-container kernel objects
+# (cgroup dirs, exec agent sockets, host veths) left on host.
+# Fails if some curve grows faster than linearly with number of containers
+# (log-log slope of total cost above 1 + TOLERANCE; per-operation latency is
+# multiplied by number of containers for that) or if anything is left on host
+# after all containers are stopped.
+#
+# usage: ./bench_scale.py [MAX_CONTS] [WORKERS] [BUSY_EVERY]
+
+import os
+import sys
+import glob
+import math
+import time
+import statistics
+import subprocess
+import concurrent.futures
+
+import test_utils as util
+import aucont
+
+PROBES = 10
+LEVELS_NUM = 5
+TOLERANCE = 0.25
+SETTLE_TIMEOUT = 30
+# noise of host-wide counters, which are not owned by aucont
+HOST_SLACK = { 'processes': 8, 'open files': 64 }
+
+def bin_path(*parts):
+    return os.path.join(os.path.dirname(util.aucont_tool_path('aucont_start')), *parts)
+
+def run_tool_ms(name, *args):
+    start = time.perf_counter()
+    output = subprocess.check_output([util.aucont_tool_path(name)] + list(args))
+    return (time.perf_counter() - start) * 1000, output.decode('UTF-8')
+
+def start_cont(busy):
+    args = ['-d']
+    if busy:
+        args += ['--cpu', '1', util.test_rootfs_path(), '/bin/sh', '-c', 'while :; do :; done']
+    else:
+        args += [util.test_rootfs_path(), '/bin/sleep', '1000000']
+    latency, output = run_tool_ms('aucont_start', *args)
+    return output.strip(), latency
+
+def mem_used_mb():
+    meminfo = {}
+    with open('/proc/meminfo') as f:
+        for line in f:
+            key, value = line.split(':')
+            meminfo[key] = int(value.split()[0])
+    return (meminfo['MemTotal'] - meminfo['MemAvailable']) / 1024
+
+def host_counters():
+    with open('/proc/sys/fs/file-nr') as f:
+        open_files = int(f.read().split()[0])
+    return {
+        'memory MB': mem_used_mb(),
+        'open files': open_files,
+        'processes': sum(1 for entry in os.listdir('/proc') if entry.isdigit()),
+    }
+
+def kernel_objects():
+    return {
+        'cgroup2 dirs': len(glob.glob(bin_path('cgroup2h', 'cont_*'))),
+        'cpu cgroup dirs': len(glob.glob(bin_path('cgrouph', 'cont_*'))),
+        'freezer dirs': len(glob.glob(bin_path('freezerh', 'cont_*'))),
+        'agent sockets': len(glob.glob(bin_path('agents', '*.sock'))),
+        'host veths': len(glob.glob('/sys/class/net/host_*_veth')),
+    }
+
+def fill(conts, target, workers, busy_every):
+    indexes = range(len(conts), target)
+    with concurrent.futures.ThreadPoolExecutor(workers) as pool:
+        started = pool.map(lambda i: start_cont(i % busy_every == busy_every - 1), indexes)
+        conts.extend(pid for pid, latency in started)
+
+def measure_level(conts):
+    probes = []
+    start_ms = []
+    for i in range(PROBES):
+        pid, latency = start_cont(False)
+        probes.append(pid)
+        start_ms.append(latency)
+    exec_ms = [run_tool_ms('aucont_exec', conts[i * len(conts) // PROBES], '/bin/hostname')[0]
+               for i in range(PROBES)]
+    list_ms = []
+    for i in range(PROBES):
+        latency, output = run_tool_ms('aucont_list')
+        list_ms.append(latency)
+        util.check(len(output.splitlines()) >= len(conts) + PROBES,
+            'aucont_list lost containers:', len(output.splitlines()))
+    # stop waits for exit, so release of container objects is counted too
+    stop_ms = [run_tool_ms('aucont_stop', '--timeout', '10', pid, '9')[0] for pid in probes]
+    return {
+        'start ms': statistics.median(start_ms),
+        'exec ms': statistics.median(exec_ms),
+        'list ms': statistics.median(list_ms),
+        'stop ms': statistics.median(stop_ms),
+    }
+
+def loglog_slope(points):
+    points = [(math.log(n), math.log(value)) for n, value in points if value > 0]
+    if len(points) < 2:
+        return 0
+    mean_x = statistics.mean(x for x, y in points)
+    mean_y = statistics.mean(y for x, y in points)
+    var_x = sum((x - mean_x) ** 2 for x, y in points)
+    return sum((x - mean_x) * (y - mean_y) for x, y in points) / var_x
+
+def check_curves(levels, baseline):
+    failed = []
+    for metric in levels[0][1]:
+        per_op = metric.endswith(' ms') and metric != 'list ms'
+        points = []
+        for n, values in levels:
+            value = values[metric] if metric.endswith(' ms') else values[metric] - baseline.get(metric, 0)
+            points.append((n, value * n if per_op else value))
+        slope = loglog_slope(points)
+        util.log('{}: growth order {:.2f}'.format(metric, slope))
+        if slope > 1 + TOLERANCE:
+            failed.append(metric)
+    return failed
+
+def settle(baseline):
+    deadline = time.monotonic() + SETTLE_TIMEOUT
+    while True:
+        # stop prunes (and releases) containers, which are reaped meanwhile;
+        # listing only reads registry
+        aucont.stop('--all', 9, timeout=SETTLE_TIMEOUT)
+        registered = len(aucont.clist())
+        leaked = { 'registered containers': registered } if registered else {}
+        now = dict(kernel_objects(), **host_counters())
+        for key, value in now.items():
+            if key != 'memory MB' and value > baseline[key] + HOST_SLACK.get(key, 0):
+                leaked[key] = value - baseline[key]
+        if not leaked or time.monotonic() > deadline:
+            return leaked
+        time.sleep(0.5)
+
+def main():
+    max_conts = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+    workers = int(sys.argv[2]) if len(sys.argv) > 2 else 8
+    busy_every = int(sys.argv[3]) if len(sys.argv) > 3 else 4
+    util.LOG_LEVEL = util.LL_INFO
+    util.check(not aucont.clist(), 'other containers are running')
+
+    baseline = dict(kernel_objects(), **host_counters())
+    baseline['container objects'] = sum(kernel_objects().values())
+    targets = sorted(set(max(1, max_conts >> i) for i in range(LEVELS_NUM)))
+    conts = []
+    levels = []
+    try:
+        for target in targets:
+            fill(conts, target, workers, busy_every)
+            values = measure_level(conts)
+            values.update(host_counters())
+            values['container objects'] = sum(kernel_objects().values())
+            levels.append((target, values))
+            util.log('{} containers: {}'.format(target, ', '.join(
+                '{} {:.1f}'.format(key, value) for key, value in values.items())))
+    finally:
+        if conts:
+            start = time.perf_counter()
+            aucont.stop('--all', 9, timeout=30)
+            util.log('aucont_stop --all of {} containers: {:.0f} ms'.format(
+                len(conts), (time.perf_counter() - start) * 1000))
+
+    leaked = settle(baseline)
+    failed = check_curves(levels, baseline)
+    util.check(not failed, 'super-linear growth:', ', '.join(failed))
+    util.check(not leaked, 'left on host after all containers exited:', leaked)
+    util.log('OK: {} containers'.format(max_conts))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,51 @@
+#!/usr/bin/python3
+
+# Measures startup cost of short aucont commands: standalone dynamically
+# linked `aucont_list` against static multi-call `aucont list`. Most of the
+# time of such command is spent between exec and main (dynamic loader
+# mapping and relocating libaucont_common and libstdc++), so wall time of
+# whole run is reported.
+#
+# usage: ./bench_startup.py [RUNS_NUM]
+
+import os
+import sys
+import time
+import tempfile
+
+import test_utils as util
+
+def run_time_us(argv, runs_num):
+    with open(os.devnull, 'w') as devnull:
+        start = time.perf_counter()
+        for i in range(runs_num):
+            pid = os.posix_spawn(argv[0], argv, os.environ,
+                file_actions=[(os.POSIX_SPAWN_DUP2, devnull.fileno(), 1)])
+            _, status = os.waitpid(pid, 0)
+            util.check(os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0,
+                ' '.join(argv), 'failed')
+        return (time.perf_counter() - start) * 1e6 / runs_num
+
+def report(name, argv, runs_num):
+    if not os.path.exists(argv[0]):
+        util.log('{}: {} not found, skipped'.format(name, argv[0]))
+        return
+    run_time_us(argv, 10) # warming up page cache
+    util.log('{}: {:.0f} us per run'.format(name, run_time_us(argv, runs_num)))
+
+def main():
+    runs_num = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+    util.LOG_LEVEL = util.LL_INFO
+    multicall = util.aucont_tool_path('aucont')
+    standalone = util.aucont_tool_path('aucont_list')
+    if os.path.realpath(standalone) == os.path.realpath(multicall):
+        util.log('aucont_list is a symlink to multi-call aucont (built with --multicall)')
+    report('aucont_list', [standalone], runs_num)
+    report('aucont list', [multicall, 'list'], runs_num)
+    with tempfile.TemporaryDirectory() as links_dir:
+        link = os.path.join(links_dir, 'aucont_list')
+        os.symlink(os.path.realpath(multicall), link)
+        report('aucont_list -> aucont', [link], runs_num)
+
+if __name__ == '__main__':
+    main()
@@ -2,6 +2,10 @@
 
 import time
 import os
+import tempfile
+import subprocess
+import threading
+import shutil
 from urllib.request import urlopen
 
 import test_utils as util
@@ -33,6 +37,26 @@ def test_fs_contents():
     util.log("\n==== CHECK THIS OUTPUT MANUALLY ====\n",
         output, "\n")
 
+def test_dev_nodes():
+    util.log("[START_TEST] check that standard device nodes and",
+        "symlinks are in container /dev")
+    output = aucont.run_cmd(
+        util.test_rootfs_path(), '/bin/ls', '/dev'
+    ).split()
+    util.debug(output)
+    for name in ['null', 'zero', 'full', 'random', 'urandom', 'tty', 'shm', 'mqueue',
+                 'fd', 'stdin', 'stdout', 'stderr']:
+        util.check(name in output, '/dev/' + name, 'is missing')
+    output = aucont.run_cmd(
+        util.test_rootfs_path(), '/bin/readlink', '/dev/fd'
+    ).strip()
+    util.check(output == '/proc/self/fd', '/dev/fd points to', output)
+    output = aucont.run_cmd(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'echo > /dev/full 2>/dev/null || echo full'
+    ).strip()
+    util.check(output == 'full', 'write to /dev/full succeeded')
+
 def test_daemonization():
     util.log("""[START_TEST] check that daemonized container doesn't
         use tty""")
@@ -48,6 +72,188 @@ def test_daemonization():
     util.debug(output)
     util.check(output != 'Ok')
 
+def test_no_lingering_processes():
+    util.log("""[START_TEST] check that no aucont process is left
+        on host for daemonized container""")
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '1000'
+    )
+    with open('/proc/' + cont_pid + '/stat') as stat:
+        parent_pid = stat.read().rsplit(')', 1)[1].split()[1]
+    with open('/proc/' + parent_pid + '/comm') as comm:
+        parent_name = comm.read().strip()
+    aucont.stop(cont_pid, 9)
+    util.debug(parent_pid, parent_name)
+    util.check(not parent_name.startswith('aucont'))
+
+def test_init_reaps_and_forwards_signals():
+    util.log("""[START_TEST] check that container started with --init
+        has no zombies and is stopped with SIGTERM""")
+    # orphaned background sleeps are reparented to PID 1
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'sh -c "sleep 0.1 &"; sh -c "sleep 0.1 &"; exec sleep 1000',
+        init=True
+    )
+    time.sleep(1)
+    output = aucont.exec_capture_output(
+        cont_pid, '/bin/sh', '-c', 'cat /proc/[0-9]*/stat'
+    )
+    util.debug(output)
+    util.check(') Z ' not in output, 'zombies are not reaped')
+    start = time.time()
+    aucont.stop(cont_pid, 15, timeout=5)
+    util.check(time.time() - start < 4, 'SIGTERM is not forwarded to workload')
+    util.check(len(aucont.clist()) == 0)
+
+def test_exec_agent():
+    util.log("""[START_TEST] check that exec agent runs commands in
+        container, passes their stdio and exit code and kills command
+        of disconnected client""")
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '1000', exec_agent=True
+    )
+    # command is in container pid and uts namespaces
+    fast_ps = aucont.exec_capture_output(cont_pid, '/bin/ps', '-eo', 'pid,args', fast=True)
+    util.debug(fast_ps)
+    util.check(' 1 aucont_pid1' in fast_ps and 'sleep 1000' in fast_ps)
+    util.check(aucont.exec_capture_output(cont_pid, '/bin/hostname', fast=True) ==
+        aucont.exec_capture_output(cont_pid, '/bin/hostname'))
+    output = aucont.exec_capture_output(cont_pid, '/bin/sh', '-c',
+        'echo out; echo err >&2; cat /proc/2/environ', fast=True)
+    util.check(output.startswith('out\nerr\n') and 'AUCONT_AGENT_FD' not in output)
+    code = subprocess.call([util.aucont_tool_path('aucont_exec'), '--fast',
+        cont_pid, '/bin/sh', '-c', 'exit 3'])
+    util.check(code == 3)
+
+    client = subprocess.Popen([util.aucont_tool_path('aucont_exec'), '--fast',
+        cont_pid, '/bin/sleep', '77'])
+    time.sleep(0.2)
+    client.kill()
+    client.wait()
+    deadline = time.time() + 2
+    while 'sleep 77' in aucont.exec_capture_output(cont_pid, '/bin/ps', '-eo', 'args', fast=True):
+        util.check(time.time() < deadline, 'command of disconnected client is running')
+        time.sleep(0.05)
+    aucont.stop(cont_pid, 9, timeout=5)
+
+    plain_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '1000'
+    )
+    code = subprocess.call([util.aucont_tool_path('aucont_exec'), '--fast',
+        plain_pid, '/bin/hostname'], stderr=subprocess.DEVNULL)
+    util.check(code != 0)
+    aucont.stop(plain_pid, 9, timeout=5)
+
+def test_daemonized_logs():
+    util.log("""[START_TEST] check that output of daemonized container
+        started with --log is captured""")
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'echo out; echo err >&2; sleep 1; echo last',
+        log=True
+    )
+    output = aucont.logs(cont_pid, follow=True)
+    util.debug(output)
+    util.check(output.split() == ['out', 'err', 'last'])
+
+def test_pause_resume():
+    util.log("""[START_TEST] check that paused container makes
+        no progress, is shown as paused and can't be exec'ed into""")
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'i=0; while true; do i=$((i+1)); echo $i; sleep 0.1; done',
+        log=True, exec_agent=True
+    )
+    time.sleep(0.5)
+    aucont.pause(cont_pid)
+    util.check(aucont.clist_lines() == [cont_pid + ' paused'])
+    progress = aucont.logs(cont_pid).split()[-1]
+    time.sleep(0.5)
+    util.check(aucont.logs(cont_pid).split()[-1] == progress)
+    output, code = aucont.exec_fanout([cont_pid], '/bin/hostname')
+    util.check(code != 0)
+    # frozen exec agent still accepts connections, so `--fast` must not reach it
+    fast_exec = subprocess.run([util.aucont_tool_path('aucont_exec'), '--fast', cont_pid, '/bin/hostname'],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, timeout=10)
+    util.check(fast_exec.returncode != 0)
+    aucont.resume(cont_pid)
+    util.check(aucont.clist_lines() == [cont_pid])
+    time.sleep(0.5)
+    util.check(aucont.logs(cont_pid).split()[-1] != progress)
+    aucont.stop(cont_pid, 9)
+
+def test_checkpoint_restore():
+    util.log("""[START_TEST] check that container checkpointed with
+        pre-dumps and restored from snapshot continues from where it was""")
+    # missing criu fails the test: checkpoint/restore must not go untested
+    util.check(shutil.which('criu') is not None or os.path.exists('/usr/sbin/criu'),
+        'criu is not installed, checkpoint/restore can\'t be tested')
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'i=0; while true; do i=$((i+1)); echo $i; sleep 0.1; done',
+        log=True
+    )
+    time.sleep(0.5)
+    snapshot = aucont.checkpoint(cont_pid, pre_dumps=2)
+    # log collector drains pipe of killed container
+    time.sleep(0.2)
+    progress = int(aucont.logs(cont_pid).split()[-1])
+    util.check(aucont.clist() == [])
+    restored_pid = aucont.restore(snapshot)
+    util.check(aucont.clist() == [restored_pid])
+    time.sleep(0.5)
+    counts = [int(count) for count in aucont.logs(restored_pid).split()]
+    util.check(len(counts) > 0 and counts[0] == progress + 1,
+        'restored container started over:', counts[:1], 'after', progress)
+    util.check(aucont.exec_capture_output(restored_pid, '/bin/hostname').strip() == 'container')
+    aucont.stop(restored_pid, 9)
+
+def test_events():
+    util.log("""[START_TEST] check that container events are
+        streamed as they happen, exit events carry exit code""")
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '1000'
+    )
+    # container without adaptive limits or --pressure-events has no cgroup v2,
+    # subscription must not create it
+    cgroup2_dir = os.path.join(os.path.dirname(util.aucont_tool_path('aucont_start')),
+        'cgroup2h', 'cont_' + cont_pid)
+    util.check(not os.path.exists(cgroup2_dir), 'cgroup v2 is created on start')
+    events = aucont.watch_events()
+    try:
+        event = aucont.next_event(events)
+        util.check(event['event'] == 'running' and str(event['pid']) == cont_pid)
+        util.check(not os.path.exists(cgroup2_dir), 'subscription changed host cgroups')
+
+        aucont.exec_capture_output(cont_pid, '/bin/hostname')
+        event = aucont.next_event(events)
+        util.check(event['event'] == 'exec' and event['args'] == ['/bin/hostname'])
+
+        aucont.pause(cont_pid)
+        util.check(aucont.next_event(events)['event'] == 'freeze')
+        aucont.resume(cont_pid)
+        util.check(aucont.next_event(events)['event'] == 'thaw')
+
+        # init of foreground container is reaped by aucont_start, so code is known,
+        # unless it's reaped before monitor saw container
+        try:
+            aucont.start_interactive(util.test_rootfs_path(), '/bin/sh', '-c', 'exit 3')
+        except subprocess.CalledProcessError:
+            pass
+        started = aucont.next_event(events, 'start')
+        event = aucont.next_event(events, 'exit')
+        util.check(event['pid'] == started['pid'] and event['code'] in (3, None))
+
+        aucont.stop(cont_pid, 9)
+        event = aucont.next_event(events, 'exit')
+        util.check(str(event['pid']) == cont_pid)
+        # daemonized init is reaped by host init, code is null if it is too slow
+        util.check(event['code'] in (137, None))
+    finally:
+        events.kill()
+        events.wait()
+
 def test_user_is_root():
     util.log("""[START_TEST] check that user name inside container
         is root""")
@@ -82,6 +288,105 @@ def test_cpu_perc_limit():
     cpu_boost = unlimited_result / limited_result_20_perc
     util.check(cpu_boost >= 3 and cpu_boost <= 5)
 
+def test_adaptive_cpu_limit():
+    util.log("""[START_TEST] check that adaptive cpu limit gives busy
+        container more cpu within its bounds and host budget, while
+        other host processes still get cpu in time""")
+    output = aucont.run_cmd(
+        util.test_rootfs_path(), '/test/busyloop/bin/run.sh',
+        cpu_perc=20
+    ).strip()
+    static_result = int(output)
+
+    controller = aucont.start_autoscale(interval_ms=200, cpu_budget=80)
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '1000',
+        cpu_perc=20, cpu_range='20:80'
+    )
+    delays = []
+    probing = True
+    def probe_latency():
+        while probing:
+            start = time.perf_counter()
+            time.sleep(0.01)
+            delays.append(time.perf_counter() - start - 0.01)
+    prober = threading.Thread(target=probe_latency)
+    prober.start()
+    try:
+        output = aucont.exec_capture_output(cont_pid, '/test/busyloop/bin/run.sh').strip()
+        adaptive_result = int(output)
+    finally:
+        probing = False
+        prober.join()
+        aucont.stop(cont_pid, 9)
+        controller.kill()
+    decisions = controller.stdout.read().decode('UTF-8').split('\n')
+    controller.wait()
+    util.debug(static_result, adaptive_result, decisions)
+
+    util.check(adaptive_result / static_result >= 2)
+    limits = [int(line.split()[6]) for line in decisions if ' cpu ' in line]
+    util.check(limits and max(limits) <= 80 and min(limits) >= 20)
+    delays.sort()
+    util.debug('p99 host wakeup delay', delays[len(delays) * 99 // 100])
+    util.check(delays[len(delays) * 99 // 100] < 0.05)
+
+def test_cpu_range_initial_limit():
+    util.log("""[START_TEST] check that container with adaptive cpu limit
+        starts with its initial limit in cpu.max of its cgroup v2, when cpu
+        controller is there, and in its own v1 cpu cgroup otherwise""")
+    cont_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '1000',
+        cpu_perc=30, cpu_range='20:80'
+    )
+    bin_dir = os.path.dirname(util.aucont_tool_path('aucont_start'))
+    cpu_max_file = os.path.join(bin_dir, 'cgroup2h', 'cont_' + cont_pid, 'cpu.max')
+    v1_dir = os.path.join(bin_dir, 'cgrouph', 'cont_' + cont_pid)
+    try:
+        if os.path.exists(cpu_max_file):
+            util.log('cpu controller is in cgroup v2')
+            with open(cpu_max_file) as f:
+                quota, period = f.read().split()
+            util.check(not os.path.exists(v1_dir), 'v1 cpu cgroup is created too')
+        else:
+            util.log('cpu controller is in cgroup v1')
+            with open(os.path.join(v1_dir, 'cpu.cfs_quota_us')) as f:
+                quota = f.read()
+            with open(os.path.join(v1_dir, 'cpu.cfs_period_us')) as f:
+                period = f.read()
+        limit = int(quota) * 100 // (int(period) * os.cpu_count())
+        util.check(limit == 30, 'initial cpu limit is', limit)
+    finally:
+        aucont.stop(cont_pid, 9)
+
+def test_tmpfs_rootfs_and_prewarm():
+    util.log("""[START_TEST] check that container with in-memory
+        rootfs doesn't modify image and prewarm list is accepted""")
+    with tempfile.NamedTemporaryFile('w') as prewarm_list:
+        prewarm_list.write('/bin\n/lib\n')
+        prewarm_list.flush()
+        output = aucont.run_cmd(
+            util.test_rootfs_path(), '/bin/sh', '-c',
+            'echo tmpfs > /tmpfs_rootfs_test && cat /tmpfs_rootfs_test',
+            prewarm=prewarm_list.name, rootfs_mode='tmpfs'
+        ).strip()
+    util.check(output == 'tmpfs')
+    util.check(not os.path.exists(
+        os.path.join(util.test_rootfs_path(), 'tmpfs_rootfs_test')))
+
+def test_prewarm_record():
+    util.log("""[START_TEST] record prewarm list of container run and
+        check that it contains workload binary and libc""")
+    with tempfile.NamedTemporaryFile('r') as prewarm_list:
+        aucont.record_prewarm(
+            util.test_rootfs_path(), prewarm_list.name, '/bin/sleep', '1'
+        )
+        paths = [line.strip() for line in prewarm_list
+            if line.strip() and not line.startswith('#')]
+    util.debug(*paths)
+    util.check('/bin/sleep' in paths)
+    util.check(any(os.path.basename(path).startswith('libc.so') for path in paths))
+
 def test_basic_networking():
     util.log(
         """[START TEST] start container with enabled networking and
@@ -105,9 +410,8 @@ def test_webserver():
     cont_ip = '192.168.1.1'
     cont_pid = aucont.start_daemonized(
         util.test_rootfs_path(), '/test/web/server.sh',
-        '80', cont_ip=cont_ip
+        '80', cont_ip=cont_ip, ready_probe='tcp:80'
     )
-    time.sleep(2)
     url = 'http://' + cont_ip + ':80/file.txt'
     http_resp = urlopen(url)
     aucont.stop(cont_pid, 9)
@@ -116,6 +420,164 @@ def test_webserver():
     util.debug(http_resp_str)
     util.check(http_resp_str.index('OK!') == 0)
 
+def test_wait_ready():
+    util.log("""[START_TEST] check that container started with --wait-ready
+        is returned exactly when workload reports readiness and that
+        result is recorded in registry""")
+    events = aucont.watch_events()
+    started = time.time()
+    ready_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'sleep 1; echo READY=1 >&$AUCONT_READY_FD; exec sleep 1000',
+        wait_ready=10
+    )
+    elapsed = time.time() - started
+    util.debug('ready after', elapsed)
+    util.check(1 <= elapsed < 2)
+    event = aucont.next_event(events, 'ready')
+    util.check(str(event['pid']) == ready_pid and event['ready'])
+
+    file_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'sleep 0.5; echo > /tmp/ready; exec sleep 1000',
+        rootfs_mode='tmpfs', ready_probe='file:/tmp/ready'
+    )
+    event = aucont.next_event(events, 'ready')
+    util.check(str(event['pid']) == file_pid and event['ready'])
+    try:
+        aucont.start_daemonized(
+            util.test_rootfs_path(), '/bin/sleep', '1000', wait_ready=1
+        )
+        util.check(False, 'not ready container is reported ready')
+    except subprocess.CalledProcessError as err:
+        # pid is printed anyway, so caller can stop container
+        unready_pid = err.output.decode('UTF-8').strip()
+    event = aucont.next_event(events, 'ready')
+    util.check(not event['ready'] and str(event['pid']) == unready_pid)
+    events.kill()
+    events.wait()
+
+    util.check(sorted(aucont.clist_lines()) == sorted([
+        ready_pid + ' ready', file_pid + ' ready', unready_pid + ' not-ready'
+    ]))
+    aucont.stop([ready_pid, file_pid, unready_pid], 9, timeout=5)
+
+    started = time.time()
+    try:
+        aucont.start_daemonized(
+            util.test_rootfs_path(), '/bin/sh', '-c', 'exit 1', wait_ready=10
+        )
+        util.check(False, 'exited container is reported ready')
+    except subprocess.CalledProcessError:
+        util.check(time.time() - started < 2)
+
+def test_net_rate_limit():
+    util.log(
+        """[START TEST] start 2 containers with enabled networking,
+        one of them with limited rate; check that traffic between them
+        stays close to the rate in both directions.
+        Warning: stop network manager before running all
+        network tests"""
+    )
+    rate = 20 * 1000 * 1000
+    limited_ip = '10.0.1.1'
+    limited_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip=limited_ip, net_rate='20m'
+    )
+    peer_ip = '10.0.2.1'
+    peer_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip=peer_ip
+    )
+    sent = aucont.net_throughput(limited_pid, peer_pid, peer_ip)
+    received = aucont.net_throughput(peer_pid, limited_pid, limited_ip)
+    util.debug(sent, received)
+    for throughput in [sent, received]:
+        util.check(rate * 0.8 < throughput < rate * 1.1)
+    cleanup()
+
+def test_net_prio():
+    util.log(
+        """[START TEST] load rate limited container with traffic from
+        other container; check that interactive container reaches
+        it without waiting in queue behind bulk traffic, unlike normal one.
+        Warning: stop network manager before running all
+        network tests"""
+    )
+    peer_ip = '10.0.1.1'
+    peer_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip=peer_ip, net_rate='10m'
+    )
+    loader_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip='10.0.2.1'
+    )
+    interactive_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip='10.0.3.1', net_prio='interactive'
+    )
+    normal_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip='10.0.4.1'
+    )
+    load = threading.Thread(target=aucont.net_throughput, args=(loader_pid, peer_pid, peer_ip, 8))
+    load.start()
+    time.sleep(2)
+    interactive_rtt = aucont.net_latency(interactive_pid, peer_pid, peer_ip, rounds=100, port=5002)
+    normal_rtt = aucont.net_latency(normal_pid, peer_pid, peer_ip, rounds=100, port=5003)
+    load.join()
+    util.debug(interactive_rtt, normal_rtt)
+    # normal packets wait in ~50 ms queue behind loader's ones
+    util.check(interactive_rtt * 10 < normal_rtt)
+    cleanup()
+
+def test_port_publishing():
+    util.log(
+        """[START TEST] start container with published port and check,
+        that other container reaches it through host address; port
+        can't be published twice and is released when container exits.
+        Warning: stop network manager before running all
+        network tests"""
+    )
+    server_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip='10.0.1.1', ports=['8080:5001']
+    )
+    client_pid = aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sleep', '10000',
+        cont_ip='10.0.2.1'
+    )
+    # client's gateway is a host address
+    throughput = aucont.net_throughput(client_pid, server_pid, '10.0.2.2',
+        seconds=1, port=5001, dst_port=8080)
+    util.debug(throughput)
+    util.check(throughput > 0)
+
+    try:
+        aucont.start_daemonized(
+            util.test_rootfs_path(), '/bin/sleep', '10000',
+            cont_ip='10.0.3.1', ports=['8080:5001']
+        )
+        util.check(False, 'port is published twice')
+    except subprocess.CalledProcessError:
+        pass
+
+    aucont.stop(server_pid, 9, timeout=5)
+    deadline = time.time() + 2
+    while True:
+        try:
+            server_pid = aucont.start_daemonized(
+                util.test_rootfs_path(), '/bin/sleep', '10000',
+                cont_ip='10.0.1.1', ports=['8080:5001']
+            )
+            break
+        except subprocess.CalledProcessError:
+            util.check(time.time() < deadline, 'port is not released')
+            time.sleep(0.1)
+    cleanup()
+
 def test_many_conts_start_stop():
     util.log("""[START_TEST] start 3 containers.
         Wait exiting of some of them.
@@ -154,6 +616,67 @@ def test_many_cont_list():
     cont_list.index(cont3_pid)
     cleanup()
 
+def test_many_conts_exec():
+    util.log("""[START_TEST] start 3 containers.
+        Run command in all of them at once, check that it runs
+        concurrently and per container timeout works""")
+    pids = [
+        aucont.start_daemonized(
+            util.test_rootfs_path(), '/bin/sleep', '1000'
+        ) for _ in range(3)
+    ]
+    start = time.time()
+    output, code = aucont.exec_fanout(
+        '--all', '/bin/sh', '-c', 'sleep 1; hostname'
+    )
+    elapsed = time.time() - start
+    util.debug(output, elapsed)
+    util.check(code == 0)
+    util.check(elapsed < 2.5)
+    for pid in pids:
+        output.index('[' + pid + '] container')
+        output.index('[' + pid + '] exit code 0')
+
+    output, code = aucont.exec_fanout(
+        pids[:2], '/bin/sleep', '10', timeout=1
+    )
+    util.debug(output)
+    util.check(code != 0)
+    output.index('[' + pids[0] + '] timed out')
+    output.index('[' + pids[1] + '] timed out')
+
+    # container, which dies before command is run there, fails alone
+    threading.Timer(0.3, os.kill, (int(pids[2]), 9)).start()
+    output, code = aucont.exec_fanout(
+        pids[1:], '/bin/sh', '-c', 'sleep 1; hostname', parallelism=1
+    )
+    util.debug(output)
+    util.check(code != 0)
+    output.index('[' + pids[1] + '] container')
+    output.index('[' + pids[1] + '] exit code 0')
+    util.check('[' + pids[2] + '] failed' in output or '[' + pids[2] + '] exit code 1' in output)
+    cleanup()
+
+def test_many_conts_graceful_stop():
+    util.log("""[START_TEST] start 3 containers, one of them
+        handles SIGTERM. Stop all of them with timeout and check,
+        that they are stopped in about one timeout""")
+    pids = [
+        aucont.start_daemonized(
+            util.test_rootfs_path(), '/bin/sleep', '1000'
+        ) for _ in range(2)
+    ]
+    pids.append(aucont.start_daemonized(
+        util.test_rootfs_path(), '/bin/sh', '-c',
+        'trap "exit 0" TERM; while true; do sleep 0.1; done'
+    ))
+    start = time.time()
+    aucont.stop(pids, timeout=1)
+    elapsed = time.time() - start
+    util.debug(elapsed)
+    util.check(elapsed < 2)
+    util.check(len(aucont.clist()) == 0)
+
 def test_many_cont_networks():
     util.log(
         """[START TEST] start 2 containers run simple networking
@@ -218,15 +741,33 @@ def main():
         test_simple_start_stop()
         test_hostname()
         test_fs_contents()
+        test_dev_nodes()
         test_daemonization()
+        test_no_lingering_processes()
+        test_init_reaps_and_forwards_signals()
+        test_exec_agent()
+        test_daemonized_logs()
+        test_pause_resume()
+        test_checkpoint_restore()
+        test_events()
+        test_wait_ready()
         test_user_is_root()
         test_user_root_is_fake()
         test_cpu_perc_limit()
+        test_adaptive_cpu_limit()
+        test_cpu_range_initial_limit()
+        test_tmpfs_rootfs_and_prewarm()
+        test_prewarm_record()
         test_basic_networking()
         test_webserver()
+        test_net_rate_limit()
+        test_net_prio()
+        test_port_publishing()
 
         test_many_conts_start_stop()
         test_many_cont_list()
+        test_many_conts_exec()
+        test_many_conts_graceful_stop()
         test_many_cont_networks()
 
         test_start_with_interactive_shell()